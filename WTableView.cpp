@@ -5,23 +5,99 @@
 #include <QPainter>
 #include <QDebug>
 #include <QMouseEvent>
+#include <QTimer>
+#include <QCursor>
+#include <QGuiApplication>
+#include <QScreen>
+#include <QFile>
+#include <QtMath>
+#include <algorithm>
 #include "WTableView.h"
 #include "WTableViewDelegate.h"
+#include "WTableViewLayout.h"
+#include "WTableViewRowCache.h"
+#include "WTableViewSelection.h"
+
+// the bar maps offsets 1:1 while they fit in an int, taller content is spread over a fixed range
+static const int ScaledScrollBarRange = 1 << 30;
+
+// height given to self-sizing rows the delegate does not estimate
+static const int SelfSizingEstimatedRowHeight = 44;
+
+// the rows are measured in the background once the width stopped changing for this long
+static const int ResizeSettleInterval = 150;
+
+// content coordinates relative to the viewport are clamped to what a widget position can hold,
+// views that far away are hidden anyway
+static int viewY(qint64 y)
+{
+    return int(qBound<qint64>(-QWIDGETSIZE_MAX,y,QWIDGETSIZE_MAX));
+}
 
 
 WTableView::WTableView(QWidget *parent,WTableViewStyle tableViewStyle) :
     QWidget(parent),
     tableFooterView(nullptr),
     delegate(nullptr),
-    tableFooterViewY(INT_MAX),
+    prefetchDelegate(nullptr),
+    scrollVelocity(0),
+    prefetchDistance(0),
+    layout(new WTableViewLayout()),
+    rowCache(new WTableViewRowCache()),
+    selection(new WTableViewSelection()),
+    tableFooterViewY(LLONG_MAX),
     tableViewStyle(tableViewStyle),
     selectedIndexPath(WIndexPath(-1,-1)),
     currentY(0),
+    contentY(0),
     contentHeight(0),
+    uniformRowHeight(0),
+    estimatedRowHeight(0),
+    selfSizingCells(false),
+    gridItemSize(QSize(0,0)),
+    followingTail(true),
+    loadMoreThreshold(0),
+    loadMoreThresholdRows(0),
+    loadingMore(false),
     allowSelection(true),
     allowMultipleSelection(false),
-    isBarSliding(false)
+    isBarSliding(false),
+    updatesDepth(0),
+    renderMode(WTableViewRenderModeWidgets),
+    hoveredIndexPath(WIndexPath(-1,-1)),
+    pressedIndexPath(WIndexPath(-1,-1)),
+    scrollPosition(0),
+    pendingScroll(0),
+    kineticVelocity(0),
+    reportedVelocity(0),
+    smoothScrolling(true),
+    pixelScrolling(false),
+    scrollGesture(false),
+    systemMomentum(false),
+    kineticScrolling(false),
+    pendingUpdates(0),
+    flushScheduled(false),
+    flushing(false),
+    instrumented(false),
+    frameOpen(false),
+    frameCount(0),
+    traceFile(nullptr),
+    traceEmpty(true)
 {
+    prefetchTimer = new QTimer(this);
+    prefetchTimer->setSingleShot(true);
+    prefetchTimer->setInterval(0);
+    connect(prefetchTimer,&QTimer::timeout,this,&WTableView::updatePrefetch);
+    measureTimer = new QTimer(this);
+    measureTimer->setSingleShot(true);
+    measureTimer->setInterval(0);
+    connect(measureTimer,&QTimer::timeout,this,&WTableView::measureEstimatedRows);
+    QScreen *screen = QGuiApplication::primaryScreen();
+    qreal refreshRate = screen && screen->refreshRate() > 0 ? screen->refreshRate() : 60;
+    scrollTimer = new QTimer(this);
+    scrollTimer->setTimerType(Qt::PreciseTimer);
+    scrollTimer->setInterval(qMax(1,qRound(1000 / refreshRate)));
+    connect(scrollTimer,&QTimer::timeout,this,&WTableView::onScrollFrame);
     bar = new QScrollBar(this);
     bar->setSingleStep(1);
     bar->setMinimum(0);
@@ -62,117 +138,178 @@ WTableView::WTableView(QWidget *parent,WTableViewStyle tableViewStyle) :
     connect(bar,&QScrollBar::valueChanged,this,&WTableView::onScrollBarValueChanged);
     connect(bar,&QScrollBar::sliderPressed,[this]{
         this->isBarSliding = true;
+        this->stopScrolling();
     });
     connect(bar,&QScrollBar::sliderReleased,[this]{
         this->isBarSliding = false;
     });
 }
 
+WTableView::~WTableView()
+{
+    stopTrace();
+    delete layout;
+    delete rowCache;
+    delete selection;
+}
+
+int WTableView::reusePoolSize()
+{
+    return cellPool.size() + headerPool.size();
+}
+
+int WTableView::reusePoolIdleSize()
+{
+    return cellPool.idleSize() + headerPool.idleSize();
+}
+
 WTableViewCell *WTableView::dequeueReusableCellByIdentifier(const QString &identifier)
 {
-    if(cellsMap.contains(identifier)){
-        QVector<WTableViewCell *> *widgets = cellsMap.value(identifier);
-        for(WTableViewCell *w: *widgets){
-            if(w->isHidden()){
-                return w;
-            }
-        }
+    WTableViewCell *cell = cellPool.dequeue(identifier);
+    if(cell && instrumented){
+        frameStats.cellsDequeued ++;
     }
-    return nullptr;
+    return cell;
 }
 
 
 WTableViewHeader *WTableView::dequeueReusableHeaderByIdentifier(const QString &identifier)
 {
-    if(headersMap.contains(identifier)){
-        QVector<WTableViewHeader *> *widgets = headersMap.value(identifier);
-        for(WTableViewHeader *w: *widgets){
-            if(w->isHidden()){
-
-                return w;
-            }
-        }
-    }
-    return nullptr;
+    return headerPool.dequeue(identifier);
 }
 
 
 void WTableView::scrollToY(int y)
 {
-    onScrollBarValueChanged(y);
+    setContentOffset(y);
 }
 
 void WTableView::setContentYOffset(quint32 y)
 {
-    bar->setValue(y);
+    setContentOffset(y);
 }
 
 void WTableView::scrollToBottom()
 {
-    bar->setValue(bar->maximum());
+    ensureContent();
+    setContentOffset(maxContentOffset());
 }
 
 void WTableView::scrollToTop()
 {
-    bar->setValue(0);
+    setContentOffset(0);
 }
 
 QSize WTableView::contentSize()
 {
-    return QSize(this->width(),contentHeight);
+    ensureContent();
+    return QSize(this->width(),int(qMin<qint64>(contentHeight,INT_MAX)));
 }
 
 int WTableView::contentOffsetY()
 {
-    return bar->value();
+    return int(qMin<qint64>(contentY,INT_MAX));
 }
 
+void WTableView::setContentOffset(qint64 y)
+{
+    ensureContent();
+    y = qBound<qint64>(0,y,maxContentOffset());
+    if(y == contentY) return;
+    contentY = y;
+    bar->blockSignals(true);
+    bar->setValue(barValueForOffset(y));
+    bar->blockSignals(false);
+    scheduleUpdates(PendingScroll);
+}
+
+qint64 WTableView::contentOffset()
+{
+    return contentY;
+}
+
+qint64 WTableView::getContentHeight()
+{
+    ensureContent();
+    return contentHeight;
+}
+
+qint64 WTableView::yForRowAtIndexPath(const WIndexPath &indexPath)
+{
+    ensureContent();
+    if(!layout->contains(indexPath)) return -1;
+    return layout->rowY(indexPath);
+}
+
+qint64 WTableView::yForHeaderInSection(int section)
+{
+    ensureContent();
+    if(section < 0 || section >= layout->numberOfSections()) return -1;
+    return layout->headerY(section);
+}
+
+// the rows may hold other content now, the selection is kept. inside beginUpdates and endUpdates the layout
+// index is rebuilt at once, the edits that follow in the batch apply to the refreshed content
 void WTableView::refreshContent()
 {
-    for(WTableViewCell *cell:showingCells.values()){
-        cell->hide();
+    if(!delegate) return;
+    if(prefetchDelegate && !prefetchingIndexPaths.isEmpty()){
+        prefetchDelegate->tableViewCancelPrefetchingForRowsAtIndexPaths(this,prefetchingIndexPaths);
     }
-    showingCells.clear();
-    for(WTableViewHeader *header:showingHeaders.values()){
-        header->hide();
+    prefetchingIndexPaths.clear();
+    rowCache->clear();
+    scheduleUpdates(PendingContent | PendingCells);
+    if(updatesDepth > 0){
+        ensureContent();
     }
-    showingHeaders.clear();
-    updateContent();
 }
 
 void WTableView::reloadData()
 {
     if(!delegate) return;
-    selectedIndexPaths.clear();
+    selection->clear();
     selectedIndexPath.setNull();
-    for(QVector<WTableViewCell *> *cells:cellsMap.values()){
-        for(WTableViewCell *cell: *cells){
-            cell->hide();
-//            delete cell;
-            cell->deleteLater();
-        }
-        delete cells;
+    if(prefetchDelegate && !prefetchingIndexPaths.isEmpty()){
+        prefetchDelegate->tableViewCancelPrefetchingForRowsAtIndexPaths(this,prefetchingIndexPaths);
     }
+    prefetchingIndexPaths.clear();
+    rowCache->clear();
+    // a page requested for the old content is not awaited any more
+    loadingMore = false;
+    // visible views go back to the pool at the next flush, the delegate reconfigures them when it dequeues them again
+    scheduleUpdates(PendingContent | PendingCells);
+}
 
-    for(QVector<WTableViewHeader *> *headers:headersMap.values()){
-        for(WTableViewHeader *header: *headers){
-            header->hide();
+void WTableView::purgeReusePool()
+{
+    for(WTableViewCell *cell:cellPool.idleViews()){
+//            delete cell;
+        cell->deleteLater();
+    }
+    for(WTableViewHeader *header:headerPool.idleViews()){
 //            delete header;
-            header->deleteLater();
-        }
-        delete headers;
+        header->deleteLater();
+    }
+    cellPool.clear();
+    headerPool.clear();
+    // visible views are registered again under fresh keys
+    for(WTableViewCell *cell:showingCells.values()){
+        cell->reuseKey = -1;
+        cellPool.claim(cell);
+    }
+    for(WTableViewHeader *header:showingHeaders.values()){
+        header->reuseKey = -1;
+        headerPool.claim(header);
     }
-
-    cellsMap.clear();
-    headersMap.clear();
-    showingCells.clear();
-    showingHeaders.clear();
-    updateContent();
 }
 
+// the layout is built from the new delegate on the next flush, or by the first call that needs it
 void WTableView::setDelegate(WTableViewDelegate *delegate)
 {
     this->delegate = delegate;
+    if(delegate){
+        scheduleUpdates(PendingContent | PendingCells);
+    }
 }
 
 WTableViewDelegate *WTableView::getDelegate()
@@ -180,6 +317,32 @@ WTableViewDelegate *WTableView::getDelegate()
     return delegate;
 }
 
+void WTableView::setPrefetchDelegate(WTableViewPrefetchDelegate *prefetchDelegate)
+{
+    if(this->prefetchDelegate && !prefetchingIndexPaths.isEmpty()){
+        this->prefetchDelegate->tableViewCancelPrefetchingForRowsAtIndexPaths(this,prefetchingIndexPaths);
+    }
+    prefetchingIndexPaths.clear();
+    this->prefetchDelegate = prefetchDelegate;
+    prefetchTimer->start();
+}
+
+WTableViewPrefetchDelegate *WTableView::getPrefetchDelegate()
+{
+    return prefetchDelegate;
+}
+
+int WTableView::getPrefetchDistance()
+{
+    return prefetchDistance;
+}
+
+void WTableView::setPrefetchDistance(int distance)
+{
+    prefetchDistance = qMax(distance,0);
+    prefetchTimer->start();
+}
+
 bool WTableView::isAllowSelection(){
     return allowSelection;
 }
@@ -197,8 +360,229 @@ void WTableView::setAllowMultipleSelection(bool allow){
     allowMultipleSelection = allow;
 }
 
+WTableView::WTableViewRenderMode WTableView::getRenderMode()
+{
+    return renderMode;
+}
+
+void WTableView::setRenderMode(WTableViewRenderMode mode)
+{
+    if(renderMode == mode) return;
+    renderMode = mode;
+    setMouseTracking(mode == WTableViewRenderModePainted);
+    hoveredIndexPath.setNull();
+    scheduleUpdates(PendingRender);
+    update();
+}
+
+qint64 WTableView::getRowCacheBudget()
+{
+    return rowCache->getBudget();
+}
+
+void WTableView::setRowCacheBudget(qint64 bytes)
+{
+    rowCache->setBudget(bytes);
+}
+
+qint64 WTableView::rowCacheSize()
+{
+    return rowCache->bytes();
+}
+
+bool WTableView::isSmoothScrolling()
+{
+    return smoothScrolling;
+}
+
+void WTableView::setSmoothScrolling(bool smooth)
+{
+    smoothScrolling = smooth;
+}
+
+qreal WTableView::getScrollVelocity()
+{
+    return kineticVelocity * 1000;
+}
+
+bool WTableView::isInstrumentationEnabled()
+{
+    return instrumented;
+}
+
+void WTableView::setInstrumentationEnabled(bool enabled)
+{
+    if(instrumented == enabled) return;
+    instrumented = enabled;
+    frameOpen = false;
+    frameStats = WTableViewFrameStats();
+    if(!enabled){
+        stopTrace();
+    }
+}
+
+WTableViewFrameStats WTableView::getLastFrameStats()
+{
+    return lastFrameStats;
+}
+
+bool WTableView::startTrace(const QString &fileName)
+{
+    stopTrace();
+    traceFile = new QFile(fileName);
+    if(!traceFile->open(QIODevice::WriteOnly | QIODevice::Truncate)){
+        delete traceFile;
+        traceFile = nullptr;
+        return false;
+    }
+    traceFile->write("[");
+    traceEmpty = true;
+    traceClock.start();
+    setInstrumentationEnabled(true);
+    return true;
+}
+
+void WTableView::stopTrace()
+{
+    if(!traceFile) return;
+    traceFile->write("\n]\n");
+    traceFile->close();
+    delete traceFile;
+    traceFile = nullptr;
+}
+
+// reports the counters recorded since the previous frame and starts a new one
+void WTableView::finishFrame()
+{
+    if(!frameOpen) return;
+    frameOpen = false;
+    frameStats.frame = ++frameCount;
+    lastFrameStats = frameStats;
+    frameStats = WTableViewFrameStats();
+    if(traceFile){
+        const WTableViewFrameStats &stats = lastFrameStats;
+        QByteArray event("{\"name\":\"frame\",\"cat\":\"WTableView\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":");
+        event.append(QByteArray::number(traceClock.nsecsElapsed() / 1000));
+        event.append(",\"args\":{\"rowsVisited\":").append(QByteArray::number(stats.rowsVisited));
+        event.append(",\"cellsDequeued\":").append(QByteArray::number(stats.cellsDequeued));
+        event.append(",\"cellsCreated\":").append(QByteArray::number(stats.cellsCreated));
+        event.append(",\"cellRequests\":").append(QByteArray::number(stats.cellRequests));
+        event.append(",\"heightRequests\":").append(QByteArray::number(stats.heightRequests));
+        event.append(",\"headerRequests\":").append(QByteArray::number(stats.headerRequests));
+        event.append(",\"paintRequests\":").append(QByteArray::number(stats.paintRequests));
+        event.append("}}");
+        writeTraceEvent(event);
+    }
+    emit tableViewFrameStats(lastFrameStats);
+}
+
+// adds the time elapsed on clock to a phase total, and writes the phase as a complete trace event
+void WTableView::recordPhase(qint64 &total, const char *name, const QElapsedTimer &clock)
+{
+    qint64 duration = clock.nsecsElapsed() / 1000;
+    total += duration;
+    if(!traceFile) return;
+    QByteArray event("{\"name\":\"");
+    event.append(name);
+    event.append("\",\"cat\":\"WTableView\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":");
+    event.append(QByteArray::number(traceClock.nsecsElapsed() / 1000 - duration));
+    event.append(",\"dur\":").append(QByteArray::number(duration));
+    event.append("}");
+    writeTraceEvent(event);
+}
+
+void WTableView::writeTraceEvent(const QByteArray &event)
+{
+    traceFile->write(traceEmpty ? "\n" : ",\n");
+    traceFile->write(event);
+    traceEmpty = false;
+}
+
+int WTableView::getUniformRowHeight()
+{
+    return uniformRowHeight;
+}
+
+void WTableView::setUniformRowHeight(int height)
+{
+    if(uniformRowHeight == height) return;
+    uniformRowHeight = height;
+    scheduleUpdates(PendingContent);
+}
+
+int WTableView::getEstimatedRowHeight()
+{
+    return estimatedRowHeight;
+}
+
+void WTableView::setEstimatedRowHeight(int height)
+{
+    if(estimatedRowHeight == height) return;
+    estimatedRowHeight = height;
+    scheduleUpdates(PendingContent);
+}
+
+bool WTableView::isSelfSizingCells()
+{
+    return selfSizingCells;
+}
+
+void WTableView::setSelfSizingCells(bool selfSizing)
+{
+    if(selfSizingCells == selfSizing) return;
+    selfSizingCells = selfSizing;
+    scheduleUpdates(PendingContent);
+}
+
+QSize WTableView::getGridItemSize()
+{
+    return gridItemSize;
+}
+
+void WTableView::setGridItemSize(const QSize &size)
+{
+    if(gridItemSize == size) return;
+    gridItemSize = size;
+    scheduleUpdates(PendingContent);
+}
+
+int WTableView::numberOfColumns()
+{
+    ensureContent();
+    return layout->getColumns();
+}
+
+// the batch starts from the current content of the delegate, a pending reload is done first.
+// in painted mode the rows are kept in a pixmap, a batch left open across the event loop still paints them
+void WTableView::beginUpdates()
+{
+    if(updatesDepth == 0){
+        ensureContent();
+        if(renderMode == WTableViewRenderModePainted && delegate && isVisible()){
+            qreal ratio = devicePixelRatioF();
+            committedFrame = QPixmap(size() * ratio);
+            committedFrame.setDevicePixelRatio(ratio);
+            render(&committedFrame,QPoint(),QRegion(),QWidget::DrawWindowBackground);
+        }
+    }
+    updatesDepth ++;
+}
+
+// no flush is queued while the batch is open, the outermost endUpdates queues one
+void WTableView::endUpdates()
+{
+    Q_ASSERT_X(updatesDepth > 0,"endUpdates","endUpdates without beginUpdates");
+    if(updatesDepth == 0) return;
+    updatesDepth --;
+    if(updatesDepth == 0){
+        committedFrame = QPixmap();
+    }
+    commitUpdates();
+}
+
 void WTableView::reloadRowAtIndexPath(const WIndexPath &indexPath)
 {
+    ensureContent();
     Q_ASSERT_X(indexPath.isValid(),"insertRowAtIndexPath","indexPath is invalid");
     Q_ASSERT_X(delegate,"reloadRowAtIndexPath","delagete is null");
     int section = delegate->numberOfSectionsInTableView(this);
@@ -206,238 +590,384 @@ void WTableView::reloadRowAtIndexPath(const WIndexPath &indexPath)
     int row = delegate->tableViewNumberOfRowsInSection(this,indexPath.section);
     Q_ASSERT_X(indexPath.row < row,"reloadRowAtIndexPath","indexPath row is out of range");
 
-    int height = delegate->tableViewHeightForRowAtIndexPath(this,indexPath);
-    int currentCellHeight = cellHeights.at(indexPath.section)->at(indexPath.row);
-    int offset = height - currentCellHeight;
-
-    if(offset != 0){
-        QList<int> *heights = cellHeights.at(indexPath.section);
-        Q_ASSERT_X(heights,"reloadRowAtIndexPath","can not find matched cell heights in section");
-        Q_ASSERT_X(heights->size() > indexPath.row,"reloadRowAtIndexPath","indexPath section is out of range");
-        heights->replace(indexPath.row,height);
-
-        Q_ASSERT_X(cellYs.size() > indexPath.section,"reloadRowAtIndexPath","indexPath section is out of range");
-        for(int i = indexPath.section; i < cellYs.size() ; i ++){
-            if(i > indexPath.section){
-                headerYs.replace(i,headerYs.at(i) + offset);
-            }
-            QList<int> *ys = cellYs.at(i);
-            for(int j = 0; j < ys->size(); j ++){
-                WIndexPath tempIndexPath(i,j);
-                if(tempIndexPath > indexPath){
-                    ys->replace(j,ys->at(j) + offset);
-                }
-            }
-        }
-        contentHeight += offset;
-        if(tableFooterView){
-            tableFooterViewY += offset;
-        }
+    Q_ASSERT_X(layout->contains(indexPath),"reloadRowAtIndexPath","indexPath is out of range of the current layout");
+    rowCache->remove(indexPath);
+    layout->removeCachedRowHeight(indexPath);
+    int height = uniformRowHeightForSection(indexPath.section);
+    if(height <= 0){
+        height = cachedHeightForRowAtIndexPath(indexPath);
+    }
+    if(height != layout->rowHeight(indexPath)){
+        layout->setRowHeight(indexPath,height);
+        updateContentHeight();
     }
 
     if(showingCells.contains(indexPath)){
-        WTableViewCell *cell = showingCells.value(indexPath);
-        cell->hide();
-        storeCell(cell);
-        showingCells.remove(indexPath);
+        recycleCell(showingCells.value(indexPath));
+        unregisterCell(indexPath);
     }
 
-    renderStartFromIndexPath(indexPath);
-
-    bar->move(this->width()-bar->width(),0);
-    bar->resize(bar->width(),this->height());
-    bar->setPageStep(this->height());
-    if(contentHeight > this->height()){
-        bar->setMaximum(contentHeight-this->height());
-//            bar->show();
-        bar->raise();
-    }else {
-        bar->setMaximum(0);
-        bar->setValue(0);
-        bar->hide();
-    }
+    commitUpdates();
 
 }
 
 ///to be tested
 void WTableView::insertRowAtIndexPath(const WIndexPath &indexPath)
 {
-    Q_ASSERT_X(indexPath.isValid(),"insertRowAtIndexPath","indexPath is invalid");
-    Q_ASSERT_X(delegate,"insertRowAtIndexPath","delagete is null");
+    insertRowsAtIndexPath(indexPath,1);
+}
+
+// the rows are measured like the rows of a reload, estimated ones are measured when they come near the viewport
+void WTableView::insertRowsAtIndexPath(const WIndexPath &indexPath, int count)
+{
+    ensureContent();
+    Q_ASSERT_X(indexPath.isValid(),"insertRowsAtIndexPath","indexPath is invalid");
+    Q_ASSERT_X(delegate,"insertRowsAtIndexPath","delagete is null");
     int sectionNumber = delegate->numberOfSectionsInTableView(this);
-    Q_ASSERT_X(indexPath.section < sectionNumber,"insertRowAtIndexPath","indexPath section is out of range");
+    Q_ASSERT_X(indexPath.section < sectionNumber,"insertRowsAtIndexPath","indexPath section is out of range");
     int rowNumber = delegate->tableViewNumberOfRowsInSection(this,indexPath.section);
-    Q_ASSERT_X(indexPath.row < rowNumber ,"insertRowAtIndexPath","indexPath row is out of range");
-    Q_ASSERT_X(indexPath.section < headerHeights.size(),"insertRowAtIndexPath","indexPath section is out of range, should use insertSection(int section) func");
-
-    int height = delegate->tableViewHeightForRowAtIndexPath(this,indexPath);
-    int addedHeight = height;
+    Q_ASSERT_X(indexPath.row + count <= rowNumber ,"insertRowsAtIndexPath","indexPath row is out of range");
+    Q_ASSERT_X(indexPath.section < layout->numberOfSections(),"insertRowsAtIndexPath","indexPath section is out of range, should use insertSection(int section) func");
+    if(count <= 0) return;
 
-    QList<int> *ys = cellYs.at(indexPath.section);
-    QList<int> *heights = cellHeights.at(indexPath.section);
-    if(ys->size() <= indexPath.row){
-        ys->push_back(ys->last() + heights->last());
-    }else {
-        ys->insert(indexPath.row,ys->at(indexPath.row));
-    }
-    heights->insert(indexPath.row,height);
-    for(int i = indexPath.section; i < cellYs.size() ; i ++){
-        if(i > indexPath.section){
-            headerYs.replace(i,headerYs.at(i) + height);
-        }
-        QList<int> *tys = cellYs.at(i);
-        for(int j = 0; j < tys->size(); j ++){
-            WIndexPath tempIndexPath(i,j);
-            if(tempIndexPath > indexPath){
-                tys->replace(j,tys->at(j) + height);
-            }
+    // rows are shifted first, the views and the rendered rows follow their rows before the new ones are measured
+    remapRows([indexPath,count](const WIndexPath &idp){
+        if(idp.section == indexPath.section && idp.row >= indexPath.row){
+            return WIndexPath(idp.section,idp.row + count);
         }
-    }
+        return idp;
+    });
+    selection->insertRows(indexPath.section,indexPath.row,count);
+    rowCache->insertRows(indexPath.section,indexPath.row,count);
 
-    QMap<WIndexPath,WTableViewCell *> tempCells;
-    for(WIndexPath idp:showingCells.keys()){
-        if(idp.section == indexPath.section && idp.row >= indexPath.row){
-            tempCells.insert(WIndexPath(indexPath.section,idp.row + 1),showingCells.value(idp));
-            if(idp.row == indexPath.row){
-                showingCells.remove(idp);
+    int uniformHeight = uniformRowHeightForSection(indexPath.section);
+    if(uniformHeight > 0){
+        layout->insertRows(indexPath,count,uniformHeight);
+    }else {
+        QVector<int> rowHeights(count);
+        QVector<bool> estimated(count);
+        for(int i = 0; i < count; i ++){
+            WIndexPath row(indexPath.section,indexPath.row + i);
+            rowHeights[i] = estimatedHeightForRowAtIndexPath(row);
+            estimated[i] = rowHeights.at(i) > 0;
+            if(!estimated.at(i)){
+                rowHeights[i] = heightForRowAtIndexPath(row);
             }
         }
+        layout->insertRows(indexPath,rowHeights,estimated);
     }
-    for(WIndexPath idp:tempCells.keys()){
-        showingCells.insert(idp,tempCells.value(idp));
-    }
-
-    contentHeight += addedHeight;
-    if(tableFooterView){
-        tableFooterViewY += addedHeight;
+    updateContentHeight();
+    if(selfSizingCells && layout->estimatedRowCount()){
+        measureTimer->start(0);
     }
 
-    renderStartFromIndexPath(indexPath);
-
-    bar->move(this->width()-bar->width(),0);
-    bar->resize(bar->width(),this->height());
-    bar->setPageStep(this->height());
-    if(contentHeight > this->height()){
-        bar->setMaximum(contentHeight-this->height());
-//        bar->show();
-        bar->raise();
-    }else {
-        bar->setMaximum(0);
-        bar->setValue(0);
-        bar->hide();
-    }
+    commitUpdates();
 
 }
 
 void WTableView::insertSection(int section)
 {
+    ensureContent();
     Q_ASSERT_X(section >= 0,"insertRowAtIndexPath","section < 0");
     Q_ASSERT_X(delegate,"insertRowAtIndexPath","delagete is null");
     int sectionNumber = delegate->numberOfSectionsInTableView(this);
     Q_ASSERT_X(section < sectionNumber,"insertRowAtIndexPath","indexPath section is out of range");
     int rowNumber = delegate->tableViewNumberOfRowsInSection(this,section);
 
-    int headerY = 0;
-    if(section != 0){
-        headerY = headerYs.at(section - 1) + headerHeights.at(section - 1);
-        QList<int> *rowYs = cellYs.at(section - 1);
-        QList<int> *rowHs = cellHeights.at(section - 1);
-        if(rowYs->size()){
-            headerY = rowYs->last() + rowHs->last();
+    remapRows([section](const WIndexPath &idp){
+        if(idp.section >= section){
+            return WIndexPath(idp.section + 1,idp.row);
         }
-    }
-    headerYs.insert(section,headerY);
+        return idp;
+    });
+    selection->insertSection(section);
+    rowCache->insertSection(section);
+    remapHeaders([section](int i){
+        return i >= section ? i + 1 : i;
+    });
 
     int sectionHeight = delegate->tableViewHeightForHeaderInSection(section);
+    int uniformHeight = uniformRowHeightForSection(section);
+    QVector<int> rowHeights(uniformHeight > 0 ? 0 : rowNumber);
+    QVector<bool> estimated(rowHeights.size());
+    for(int i = 0 ; i < rowHeights.size() ; i ++){
+        WIndexPath indexPath(section,i);
+        int rowHeight = estimatedHeightForRowAtIndexPath(indexPath);
+        estimated[i] = rowHeight > 0;
+        if(!estimated.at(i)){
+            rowHeight = heightForRowAtIndexPath(indexPath);
+        }
+        rowHeights[i] = rowHeight;
+    }
+    if(uniformHeight > 0){
+        layout->insertSection(section,sectionHeight,rowNumber,uniformHeight);
+    }else {
+        layout->insertSection(section,sectionHeight,rowHeights,estimated);
+    }
+    updateContentHeight();
 
-    int cellY = headerY + sectionHeight;
+    commitUpdates();
 
-    headerHeights.insert(section,sectionHeight);
-    int offset = sectionHeight;
-    QList<int> *rowHeights = new QList<int>();
-    QList<int> *rowYs = new QList<int>;
-    for(int i = 0 ; i < rowNumber ; i ++){
-        int rowHeight = delegate->tableViewHeightForRowAtIndexPath(this,WIndexPath(section,i));
-        offset += rowHeight;
-        rowHeights->push_back(rowHeight);
 
-        rowYs->push_back(cellY);
-        cellY += rowHeight;
-    }
-    this->cellHeights.insert(section,rowHeights);
-    this->cellYs.insert(section,rowYs);
+}
 
-    for(int i = section + 1;i < headerYs.size(); i ++){
-        headerYs.replace(i,headerYs.at(i) + offset);
-    }
+void WTableView::deleteRowAtIndexPath(const WIndexPath &indexPath)
+{
+    deleteRowsAtIndexPath(indexPath,1);
+}
+
+void WTableView::deleteRowsAtIndexPath(const WIndexPath &indexPath, int count)
+{
+    ensureContent();
+    Q_ASSERT_X(indexPath.isValid(),"deleteRowsAtIndexPath","indexPath is invalid");
+    Q_ASSERT_X(delegate,"deleteRowsAtIndexPath","delagete is null");
+    Q_ASSERT_X(count >= 0 && indexPath.section < layout->numberOfSections() && indexPath.row + count <= layout->numberOfRowsInSection(indexPath.section),"deleteRowsAtIndexPath","indexPath is out of range");
+    Q_ASSERT_X(updatesDepth > 0 || delegate->tableViewNumberOfRowsInSection(this,indexPath.section) == layout->numberOfRowsInSection(indexPath.section) - count,"deleteRowsAtIndexPath","the rows should be removed from the delegate first");
+    if(count <= 0) return;
 
-    for(int i = section + 1;i < this->cellYs.size();i ++){
-        QList<int> *ys = cellYs.at(i);
-        for(int j = 0;j < ys->size();j ++){
-            ys->replace(j,ys->at(j) + offset);
+    layout->removeRows(indexPath,count);
+    updateContentHeight();
+
+    remapRows([indexPath,count](const WIndexPath &idp){
+        if(idp.section == indexPath.section && idp.row >= indexPath.row){
+            if(idp.row < indexPath.row + count) return WIndexPath(-1,-1);
+            return WIndexPath(idp.section,idp.row - count);
         }
-    }
+        return idp;
+    });
+    selection->removeRows(indexPath.section,indexPath.row,count);
+    rowCache->removeRows(indexPath.section,indexPath.row,count);
 
-    QMap<WIndexPath,WTableViewCell *> tempCells;
-    for(WIndexPath idp:showingCells.keys()){
-        if(idp.section >= section){
-            tempCells.insert(WIndexPath(idp.section + 1,idp.row),showingCells.value(idp));
+    commitUpdates();
+}
+
+void WTableView::deleteSection(int section)
+{
+    ensureContent();
+    Q_ASSERT_X(delegate,"deleteSection","delagete is null");
+    Q_ASSERT_X(section >= 0 && section < layout->numberOfSections(),"deleteSection","section is out of range");
+    Q_ASSERT_X(updatesDepth > 0 || delegate->numberOfSectionsInTableView(this) == layout->numberOfSections() - 1,"deleteSection","the section should be removed from the delegate first");
+
+    layout->removeSection(section);
+    updateContentHeight();
+
+    remapRows([section](const WIndexPath &idp){
+        if(idp.section == section) return WIndexPath(-1,-1);
+        if(idp.section > section) return WIndexPath(idp.section - 1,idp.row);
+        return idp;
+    });
+    selection->removeSection(section);
+    rowCache->removeSection(section);
+    remapHeaders([section](int i){
+        if(i == section) return -1;
+        return i > section ? i - 1 : i;
+    });
+
+    commitUpdates();
+}
+
+// toIndexPath is the position of the row once it has been taken out of fromIndexPath
+void WTableView::moveRowAtIndexPath(const WIndexPath &fromIndexPath, const WIndexPath &toIndexPath)
+{
+    moveRowsAtIndexPath(fromIndexPath,1,toIndexPath);
+}
+
+// the rows keep their heights, the views and the rendered rows follow them
+void WTableView::moveRowsAtIndexPath(const WIndexPath &fromIndexPath, int count, const WIndexPath &toIndexPath)
+{
+    ensureContent();
+    Q_ASSERT_X(delegate,"moveRowsAtIndexPath","delagete is null");
+    Q_ASSERT_X(fromIndexPath.isValid() && fromIndexPath.section < layout->numberOfSections(),"moveRowsAtIndexPath","fromIndexPath is out of range");
+    Q_ASSERT_X(count >= 0 && fromIndexPath.row + count <= layout->numberOfRowsInSection(fromIndexPath.section),"moveRowsAtIndexPath","count is out of range");
+    Q_ASSERT_X(toIndexPath.isValid() && toIndexPath.section < layout->numberOfSections(),"moveRowsAtIndexPath","toIndexPath is out of range");
+    Q_ASSERT_X(toIndexPath.row <= layout->numberOfRowsInSection(toIndexPath.section) - (toIndexPath.section == fromIndexPath.section ? count : 0),"moveRowsAtIndexPath","toIndexPath row is out of range");
+    if(count <= 0 || fromIndexPath == toIndexPath) return;
+
+    layout->moveRows(fromIndexPath,count,toIndexPath);
+    updateContentHeight();// grid lines come and go when the rows change section
+
+    remapRows([fromIndexPath,count,toIndexPath](const WIndexPath &idp){
+        if(idp.section == fromIndexPath.section && idp.row >= fromIndexPath.row && idp.row < fromIndexPath.row + count){
+            return WIndexPath(toIndexPath.section,toIndexPath.row + idp.row - fromIndexPath.row);
         }
-    }
+        WIndexPath moved = idp;
+        if(moved.section == fromIndexPath.section && moved.row > fromIndexPath.row){
+            moved.row -= count;
+        }
+        if(moved.section == toIndexPath.section && moved.row >= toIndexPath.row){
+            moved.row += count;
+        }
+        return moved;
+    });
+    selection->moveRows(fromIndexPath,count,toIndexPath);
+    rowCache->moveRows(fromIndexPath,count,toIndexPath);
 
-    for(WIndexPath idp:tempCells.keys()){
-        showingCells.remove(WIndexPath(idp.section - 1,idp.row));
-    }
+    commitUpdates();
+}
 
-    for(WIndexPath idp:tempCells.keys()){
-        showingCells.insert(idp,tempCells.value(idp));
+// droppedFromHead rows were dropped by the delegate before or while the count rows were appended, as a full
+// WTableViewRingBuffer does. rows appended and dropped again within the same call never reach the layout
+void WTableView::appendRows(int section, int count, int droppedFromHead)
+{
+    ensureContent();
+    Q_ASSERT_X(delegate,"appendRows","delagete is null");
+    Q_ASSERT_X(section >= 0 && section < layout->numberOfSections(),"appendRows","section is out of range");
+    Q_ASSERT_X(droppedFromHead >= 0 && droppedFromHead <= layout->numberOfRowsInSection(section) + count,"appendRows","droppedFromHead is out of range");
+    Q_ASSERT_X(updatesDepth > 0 || delegate->tableViewNumberOfRowsInSection(this,section) == layout->numberOfRowsInSection(section) + count - droppedFromHead,"appendRows","the rows should be appended to the delegate first");
+    int removed = qMin(droppedFromHead,layout->numberOfRowsInSection(section));
+    count -= droppedFromHead - removed;
+    if(count <= 0 && removed <= 0) return;
+    bool atBottom = followingTail && contentY >= maxContentOffset();
+    removeLayoutRowsFromHead(section,removed);
+    appendLayoutRows(section,count);
+    if(atBottom){
+        contentY = maxContentOffset();
     }
+    commitUpdates();
+}
 
-    contentHeight += offset;
-    if(tableFooterView){
-        tableFooterViewY += offset;
+// rows read above the viewport go away without moving the visible rows on screen
+void WTableView::removeRowsFromHead(int section, int count)
+{
+    ensureContent();
+    Q_ASSERT_X(delegate,"removeRowsFromHead","delagete is null");
+    Q_ASSERT_X(section >= 0 && section < layout->numberOfSections(),"removeRowsFromHead","section is out of range");
+    Q_ASSERT_X(count <= layout->numberOfRowsInSection(section),"removeRowsFromHead","count is out of range");
+    Q_ASSERT_X(updatesDepth > 0 || delegate->tableViewNumberOfRowsInSection(this,section) == layout->numberOfRowsInSection(section) - count,"removeRowsFromHead","the rows should be removed from the delegate first");
+    if(count <= 0) return;
+    bool atBottom = followingTail && contentY >= maxContentOffset();
+    removeLayoutRowsFromHead(section,count);
+    if(atBottom){
+        contentY = maxContentOffset();
     }
+    commitUpdates();
+}
 
-    renderStartFromIndexPath(WIndexPath(section,0));
-
-    bar->move(this->width()-bar->width(),0);
-    bar->resize(bar->width(),this->height());
-    bar->setPageStep(this->height());
-    if(contentHeight > this->height()){
-        bar->setMaximum(contentHeight-this->height());
-//        bar->show();
-        bar->raise();
+void WTableView::appendLayoutRows(int section, int count)
+{
+    if(count <= 0) return;
+    int first = layout->numberOfRowsInSection(section);
+    int uniformHeight = uniformRowHeightForSection(section);
+    if(uniformHeight > 0){
+        layout->insertRows(WIndexPath(section,first),count,uniformHeight);
     }else {
-        bar->setMaximum(0);
-        bar->setValue(0);
-        bar->hide();
+        QVector<int> rowHeights(count);
+        QVector<bool> estimated(count);
+        for(int i = 0; i < count; i ++){
+            WIndexPath indexPath(section,first + i);
+            rowHeights[i] = estimatedHeightForRowAtIndexPath(indexPath);
+            estimated[i] = rowHeights.at(i) > 0;
+            if(!estimated.at(i)){
+                rowHeights[i] = heightForRowAtIndexPath(indexPath);
+            }
+        }
+        layout->insertRows(WIndexPath(section,first),rowHeights,estimated);
+    }
+    updateContentHeight();
+    if(selfSizingCells && layout->estimatedRowCount()){
+        measureTimer->start(0);
     }
+}
 
+void WTableView::removeLayoutRowsFromHead(int section, int count)
+{
+    if(count <= 0) return;
+    qint64 top = layout->rowY(WIndexPath(section,0));
+    qint64 before = layout->contentHeight();
+    layout->removeRows(WIndexPath(section,0),count);
+    qint64 removedHeight = before - layout->contentHeight();
+
+    remapRows([section,count](const WIndexPath &idp){
+        if(idp.section != section) return idp;
+        if(idp.row < count) return WIndexPath(-1,-1);
+        return WIndexPath(idp.section,idp.row - count);
+    });
+    selection->removeRows(section,0,count);
+    rowCache->removeRows(section,0,count);
 
+    updateContentHeight();
+    qint64 shift = qBound<qint64>(0,contentY - top,removedHeight);
+    contentY -= shift;
+    currentY -= shift;
+    scrollPosition -= shift;
 }
 
-void WTableView::deleteRowAtIndexPath(const WIndexPath &indexPath)
+int WTableView::getLoadMoreThreshold()
 {
-    Q_ASSERT_X(indexPath.isValid(),"insertRowAtIndexPath","indexPath is invalid");
-    Q_ASSERT_X(delegate,"insertRowAtIndexPath","delagete is null");
-    int section = delegate->numberOfSectionsInTableView(this);
-    Q_ASSERT_X(indexPath.section < section,"insertRowAtIndexPath","indexPath section is out of range");
-    int row = delegate->tableViewNumberOfRowsInSection(this,indexPath.section);
-    Q_ASSERT_X(indexPath.row < row ,"insertRowAtIndexPath","indexPath row is out of range");
+    return loadMoreThreshold;
+}
+
+void WTableView::setLoadMoreThreshold(int pixels)
+{
+    loadMoreThreshold = qMax(pixels,0);
+    scheduleUpdates(PendingRender);
+}
 
-    //TODO to be countinued;
+int WTableView::getLoadMoreThresholdRows()
+{
+    return loadMoreThresholdRows;
+}
+
+void WTableView::setLoadMoreThresholdRows(int rows)
+{
+    loadMoreThresholdRows = qMax(rows,0);
+    scheduleUpdates(PendingRender);
+}
+
+bool WTableView::isLoadingMore()
+{
+    return loadingMore;
+}
+
+void WTableView::finishLoadingMore(int section, int count)
+{
+    loadingMore = false;
+    if(section >= 0 && count > 0){
+        // a page does not drag a table scrolled to the bottom to the end of the page
+        bool follow = followingTail;
+        followingTail = false;
+        appendRows(section,count);
+        followingTail = follow;
+    }
+}
+
+// runs after every flush, a short page still leaves the viewport near the end and loads the next one
+void WTableView::checkLoadMore()
+{
+    if(!delegate || loadingMore || updatesDepth > 0 || (loadMoreThreshold <= 0 && loadMoreThresholdRows <= 0)) return;
+    qint64 bottom = contentY + this->height();
+    bool nearEnd = loadMoreThreshold > 0 && layout->contentHeight() - bottom < loadMoreThreshold;
+    if(!nearEnd && loadMoreThresholdRows > 0){
+        int rows = 0;
+        for(WIndexPath indexPath = layout->firstRowFromY(bottom); indexPath.isValid() && rows < loadMoreThresholdRows; indexPath = layout->nextIndexPath(indexPath)){
+            rows ++;
+        }
+        nearEnd = rows < loadMoreThresholdRows;
+    }
+    if(!nearEnd) return;
+    loadingMore = true;
+    delegate->tableViewLoadMoreRows(this);
+}
+
+bool WTableView::isFollowingTail()
+{
+    return followingTail;
+}
+
+void WTableView::setFollowingTail(bool follow)
+{
+    followingTail = follow;
 }
 
 void WTableView::selectedRowAtIndexPath(const WIndexPath &indexPath)
 {
     if(!allowSelection) return;
-    Q_ASSERT_X(indexPath.section <= headerHeights.size(),"selectedRowAtIndexPath","out of range");
-    Q_ASSERT_X(indexPath.row <= cellHeights.at(indexPath.section)->size(),"selectedRowAtIndexPath","out of range");
+    ensureContent();
+    Q_ASSERT_X(indexPath.section <= layout->numberOfSections(),"selectedRowAtIndexPath","out of range");
+    Q_ASSERT_X(indexPath.row <= layout->numberOfRowsInSection(indexPath.section),"selectedRowAtIndexPath","out of range");
 
     if(allowMultipleSelection){
-        if(!selectedIndexPaths.contains(indexPath)){
-            selectedIndexPaths.push_back(indexPath);
-        }
+        selection->selectRows(indexPath.section,indexPath.row,indexPath.row);
     }else {
         if(indexPath != selectedIndexPath){
             selectedIndexPath = indexPath;
@@ -447,17 +977,19 @@ void WTableView::selectedRowAtIndexPath(const WIndexPath &indexPath)
     if(cell){
         cell->setSelected(true);
     }
+    if(renderMode == WTableViewRenderModePainted){
+        scheduleUpdates(PendingRender);
+    }
 }
 
 void WTableView::deselectRowAtIndexPath(const WIndexPath &indexPath)
 {
     if(!allowSelection) return;
-    Q_ASSERT_X(indexPath.section <= headerHeights.size(),"deselectRowAtIndexPath","out of range");
-    Q_ASSERT_X(indexPath.row <= cellHeights.at(indexPath.section)->size(),"deselectRowAtIndexPath","out of range");
+    ensureContent();
+    Q_ASSERT_X(indexPath.section <= layout->numberOfSections(),"deselectRowAtIndexPath","out of range");
+    Q_ASSERT_X(indexPath.row <= layout->numberOfRowsInSection(indexPath.section),"deselectRowAtIndexPath","out of range");
     if(allowMultipleSelection){
-        if(selectedIndexPaths.contains(indexPath)){
-            selectedIndexPaths.removeAll(indexPath);
-        }
+        selection->deselectRows(indexPath.section,indexPath.row,indexPath.row);
     }else {
         if(indexPath == selectedIndexPath){
             selectedIndexPath = WIndexPath(-1,-1);
@@ -467,10 +999,69 @@ void WTableView::deselectRowAtIndexPath(const WIndexPath &indexPath)
     if(cell){
         cell->setSelected(false);
     }
+    if(renderMode == WTableViewRenderModePainted){
+        scheduleUpdates(PendingRender);
+    }
+}
+
+void WTableView::selectAll()
+{
+    if(!allowSelection || !allowMultipleSelection) return;
+    ensureContent();
+    for(int i = 0; i < layout->numberOfSections(); i ++){
+        selection->selectRows(i,0,layout->numberOfRowsInSection(i) - 1);
+    }
+    scheduleUpdates(PendingRender);
+}
+
+void WTableView::selectRowsInRange(const WIndexPath &fromIndexPath, const WIndexPath &toIndexPath)
+{
+    if(!allowSelection || !allowMultipleSelection) return;
+    ensureContent();
+    Q_ASSERT_X(layout->contains(fromIndexPath) && layout->contains(toIndexPath),"selectRowsInRange","out of range");
+    Q_ASSERT_X(fromIndexPath <= toIndexPath,"selectRowsInRange","fromIndexPath is after toIndexPath");
+    for(int i = fromIndexPath.section; i <= toIndexPath.section; i ++){
+        int first = i == fromIndexPath.section ? fromIndexPath.row : 0;
+        int last = i == toIndexPath.section ? toIndexPath.row : layout->numberOfRowsInSection(i) - 1;
+        selection->selectRows(i,first,last);
+    }
+    scheduleUpdates(PendingRender);
+}
+
+void WTableView::invertSelection()
+{
+    if(!allowSelection || !allowMultipleSelection) return;
+    ensureContent();
+    for(int i = 0; i < layout->numberOfSections(); i ++){
+        selection->invertRows(i,0,layout->numberOfRowsInSection(i) - 1);
+    }
+    scheduleUpdates(PendingRender);
+}
+
+void WTableView::clearSelection()
+{
+    selection->clear();
+    selectedIndexPath.setNull();
+    scheduleUpdates(PendingRender);
+}
+
+QVector<WIndexPath> WTableView::indexPathsForSelectedRows()
+{
+    if(!allowMultipleSelection){
+        return selectedIndexPath.isValid() ? QVector<WIndexPath>() << selectedIndexPath : QVector<WIndexPath>();
+    }
+    return selection->indexPaths();
+}
+
+qint64 WTableView::numberOfSelectedRows()
+{
+    if(!allowMultipleSelection) return selectedIndexPath.isValid() ? 1 : 0;
+    return selection->count();
 }
 
 void WTableView::setTableFooterView(QWidget *footerView)
 {
+    ensureContent();
     if(tableFooterView){
         contentHeight -= tableFooterView->height();
         delete tableFooterView;
@@ -481,22 +1072,10 @@ void WTableView::setTableFooterView(QWidget *footerView)
         tableFooterViewY = contentHeight;
         contentHeight += tableFooterView->height();
     }else {
-        tableFooterViewY = INT_MAX;
+        tableFooterViewY = LLONG_MAX;
     }
 
-    renderStartFromIndexPath();
-    bar->move(this->width()-bar->width(),0);
-    bar->resize(bar->width(),this->height());
-    bar->setPageStep(this->height());
-    if(contentHeight > this->height()){
-        bar->setMaximum(contentHeight-this->height());
-//        bar->show();
-        bar->raise();
-    }else {
-        bar->setMaximum(0);
-        bar->setValue(0);
-        bar->hide();
-    }
+    commitUpdates();
 
 }
 
@@ -506,81 +1085,193 @@ QWidget *WTableView::getTableFooterView()
 }
 
 WIndexPath WTableView::indexPathForRowAtPoint(const QPoint &p)
-{
-    //to be test
-    WIndexPath indexPath = WIndexPath(-1,-1);
-    for(WTableViewCell *cell:showingCells){
-        if(cell->geometry().contains(p)){
-            indexPath = showingCells.key(cell,indexPath);
-            break;
-        }
-    }
-    return indexPath;
+{
+    if(p.x() < 0 || p.x() >= this->width()) return WIndexPath(-1,-1);
+    ensureContent();
+    WIndexPath indexPath = layout->indexPathForRowAtY(p.y() + contentY);
+    if(!indexPath.isValid() || layout->getColumns() == 1) return indexPath;
+    // the first row of the line is returned by the layout
+    indexPath.row += qMin<qint64>(qint64(p.x()) * layout->getColumns() / this->width(),layout->getColumns() - 1);
+    return layout->contains(indexPath) ? indexPath : WIndexPath(-1,-1);
 }
 
 WIndexPath WTableView::indexPathForCell(WTableViewCell *cell)
 {
     //to be test
-     WIndexPath indexPath =  showingCells.key(cell,WIndexPath(-1,-1));
+     flushPendingUpdates();
+     WIndexPath indexPath =  showingCellIndexPaths.value(cell,WIndexPath(-1,-1));
      return indexPath;
 }
 
 WTableViewCell *WTableView::cellForRowAtIndexPath(const WIndexPath &indexPath)
 {
+    flushPendingUpdates();
     return showingCells.value(indexPath);
 }
 
 QVector<WIndexPath> WTableView::indexPathsForVisibleRows()
 {
-    return showingCells.keys().toVector();
+    flushPendingUpdates();
+    QVector<WIndexPath> indexPaths = showingCells.keys().toVector();
+    std::sort(indexPaths.begin(),indexPaths.end());
+    return indexPaths;
 }
 
 QVector<WTableViewCell *> WTableView::visibleCells()
 {
-    return showingCells.values().toVector();
+    QVector<WTableViewCell *> cells;
+    for(const WIndexPath &indexPath:indexPathsForVisibleRows()){
+        cells.push_back(showingCells.value(indexPath));
+    }
+    return cells;
 }
 
 QRect WTableView::rectForRowAtIndexPath(const WIndexPath &indexPath)
 {
-    if(cellYs.size() <= indexPath.section) return QRect();
-    QList<int> *list = cellYs.at(indexPath.section);
-    if(list->size() <= indexPath.row) return QRect();
-    if(cellHeights.size() <= indexPath.section) return QRect();
-    QList<int> *heights = cellHeights.at(indexPath.section);
-    if(heights->size() <= indexPath.row) return QRect();
-    int y = list->at(indexPath.row);
-    int height = heights->at(indexPath.row);
-
-    return QRect(0,y,width(),height);
-
+    ensureContent();
+    if(!layout->contains(indexPath)) return QRect();
+    return QRect(cellX(indexPath),int(qMin<qint64>(layout->rowY(indexPath),INT_MAX)),cellWidth(indexPath),layout->rowHeight(indexPath));
 }
 
 QRect WTableView::rectForHeaderInSection(int section)
 {
-    if(headerYs.size() <= section) return QRect();
-    if(headerHeights.size() <= section) return QRect();
-    return QRect(0,headerYs.at(section),width(),headerHeights.at(section));
+    ensureContent();
+    if(section < 0 || layout->numberOfSections() <= section) return QRect();
+    return QRect(0,int(qMin<qint64>(layout->headerY(section),INT_MAX)),width(),layout->headerHeight(section));
 }
 
 
+// a height change only moves the viewport and the scroll bar, row heights are kept
 void WTableView::resizeEvent(QResizeEvent *event)
 {
-    updateContent();
+    quint8 updates = PendingScrollBar | PendingRender;
+    if(event->size().width() != event->oldSize().width() && delegate && (selfSizingCells || delegate->tableViewRowHeightsDependOnWidth(this))){
+        updates |= PendingRowHeights;
+    }
+    if(delegate && !gridItemSize.isEmpty() && columnsForWidth(event->size().width()) != layout->getColumns()){
+        // the items reflow into a new number of columns, the first visible item stays at the top of the view
+        ensureContent();
+        WIndexPath anchor = layout->firstRowFromY(contentY);
+        qint64 anchorOffset = anchor.isValid() ? layout->rowY(anchor) - contentY : 0;
+        updateContent();
+        if(layout->contains(anchor)){
+            qint64 shift = layout->rowY(anchor) - anchorOffset - contentY;
+            contentY += shift;
+            currentY += shift;
+            scrollPosition += shift;
+        }
+    }
+    scheduleUpdates(updates);
     QWidget::resizeEvent(event);
 }
 
 
+// wheel events only accumulate distance, onScrollFrame applies it once per display frame
 void WTableView::wheelEvent(QWheelEvent *event)
 {
-    int step = bar->value() - event->delta() * 0.5;
-    bar->setValue(step);
+    if(!scrollTimer->isActive()){
+        scrollPosition = contentY;
+        frameClock.start();
+        scrollTimer->start();
+    }
+    if(!event->pixelDelta().isNull()){
+        pixelScrolling = true;
+        pendingScroll -= event->pixelDelta().y();
+        switch (event->phase()) {
+        case Qt::ScrollBegin:
+            kineticScrolling = false;
+            kineticVelocity = 0;
+            systemMomentum = false;
+            scrollGesture = true;
+            break;
+        case Qt::ScrollUpdate:
+            scrollGesture = true;
+            break;
+        case Qt::ScrollMomentum:
+            systemMomentum = true;
+            scrollGesture = false;
+            break;
+        case Qt::ScrollEnd:
+            // the platform did not send its own momentum events, the engine glides on
+            kineticScrolling = smoothScrolling && !systemMomentum;
+            scrollGesture = false;
+            break;
+        default:
+            break;
+        }
+    }else {
+        pixelScrolling = false;
+        kineticScrolling = false;
+        pendingScroll -= event->angleDelta().y() * 0.5;
+    }
     QWidget::wheelEvent(event);
 }
 
+void WTableView::onScrollFrame()
+{
+    qreal dt = qBound<qint64>(1,frameClock.restart(),50);
+    if(qRound64(scrollPosition) != contentY){
+        scrollPosition = contentY;// moved by the scroll bar or the API in between
+    }
+    qreal step = 0;
+    if(pendingScroll != 0){
+        if(pixelScrolling || !smoothScrolling || qAbs(pendingScroll) < 1){
+            step = pendingScroll;
+        }else {
+            step = pendingScroll * (1 - qExp(-dt / 50));// a wheel notch glides over about 150ms
+        }
+        pendingScroll -= step;
+        kineticVelocity = pixelScrolling ? kineticVelocity * 0.2 + step / dt * 0.8 : step / dt;
+    }else if(kineticScrolling){
+        step = kineticVelocity * dt;
+        kineticVelocity *= qExp(-dt / 325);
+        if(qAbs(kineticVelocity) < 0.02){
+            kineticScrolling = false;
+        }
+    }else if(scrollGesture){
+        kineticVelocity *= 0.5;// fingers resting on the touchpad
+    }else {
+        kineticVelocity = 0;
+    }
+
+    scrollPosition += step;
+    qint64 maximum = maxContentOffset();
+    if(scrollPosition < 0 || scrollPosition > maximum){
+        scrollPosition = qBound<qreal>(0,scrollPosition,maximum);
+        pendingScroll = 0;
+        kineticScrolling = false;
+        kineticVelocity = 0;
+    }
+    bool idle = pendingScroll == 0 && !kineticScrolling && !scrollGesture;
+    if(idle){
+        kineticVelocity = 0;
+        scrollTimer->stop();
+    }
+    setContentOffset(qRound64(scrollPosition));
+    if(delegate && reportedVelocity != kineticVelocity){
+        reportedVelocity = kineticVelocity;
+        delegate->tableViewDidChangeScrollVelocity(this,kineticVelocity * 1000);
+    }
+}
+
+void WTableView::stopScrolling()
+{
+    pendingScroll = 0;
+    kineticScrolling = false;
+    scrollGesture = false;
+    kineticVelocity = 0;
+    scrollTimer->stop();
+    if(delegate && reportedVelocity != 0){
+        reportedVelocity = 0;
+        delegate->tableViewDidChangeScrollVelocity(this,0);
+    }
+}
+
 void WTableView::enterEvent(QEvent *e)
 {
+    ensureContent();
+    updateScrollBar();
     if(contentHeight > this->height()){
-        bar->setMaximum(contentHeight-this->height());
         bar->show();
         bar->raise();
     }
@@ -592,6 +1283,10 @@ void WTableView::leaveEvent(QEvent *e)
     if(this->isBarSliding == false){
         bar->hide();
     }
+    if(renderMode == WTableViewRenderModePainted && hoveredIndexPath.isValid()){
+        hoveredIndexPath.setNull();
+        scheduleUpdates(PendingRender);
+    }
     QWidget::leaveEvent(e);
 }
 
@@ -601,25 +1296,129 @@ void WTableView::paintEvent(QPaintEvent *event)
     opt.init(this);
     QPainter p(this);
     style()->drawPrimitive(QStyle::PE_Widget, &opt, &p, this);
+    QElapsedTimer clock;
+    if(instrumented){
+        clock.start();
+        frameOpen = true;
+    }
+    if(renderMode == WTableViewRenderModePainted && updatesDepth > 0 && !committedFrame.isNull()){
+        p.drawPixmap(0,0,committedFrame);
+    }else if(renderMode == WTableViewRenderModePainted && delegate && updatesDepth == 0){
+        // rows backed by a cell widget are painted by the widget
+        qint64 value = currentY;
+        qint64 bottom = value + event->rect().bottom() + 1;
+        for(WIndexPath indexPath = layout->firstRowFromY(value + event->rect().top()); indexPath.isValid(); indexPath = layout->nextIndexPath(indexPath)){
+            qint64 y = layout->rowY(indexPath);
+            if(y >= bottom) break;
+            if(instrumented){
+                frameStats.rowsVisited ++;
+            }
+            if(showingCells.contains(indexPath)) continue;
+            QRect rect(cellX(indexPath),viewY(y - value),cellWidth(indexPath),layout->rowHeight(indexPath));
+            bool selected = isRowSelected(indexPath);
+            if(rowCache->getBudget() > 0){
+                quint64 version = delegate->tableViewContentVersionForRowAtIndexPath(this,indexPath);
+                const QPixmap *pixmap = rowCache->find(indexPath,version,selected,rect.size());
+                if(!pixmap){
+                    qreal ratio = devicePixelRatioF();
+                    QPixmap rendered(rect.size() * ratio);
+                    rendered.setDevicePixelRatio(ratio);
+                    rendered.fill(Qt::transparent);
+                    QPainter rowPainter(&rendered);
+                    if(instrumented){
+                        frameStats.paintRequests ++;
+                    }
+                    delegate->tableViewPaintRowAtIndexPath(this,&rowPainter,QRect(QPoint(0,0),rect.size()),indexPath,selected);
+                    rowPainter.end();
+                    pixmap = rowCache->insert(indexPath,version,selected,rect.size(),rendered);
+                    if(!pixmap){
+                        // over the budget, the pixmap is drawn once rather than painted again
+                        p.drawPixmap(rect.topLeft(),rendered);
+                        continue;
+                    }
+                }
+                p.drawPixmap(rect.topLeft(),*pixmap);
+                continue;
+            }
+            p.save();
+            p.setClipRect(rect);
+            if(instrumented){
+                frameStats.paintRequests ++;
+            }
+            delegate->tableViewPaintRowAtIndexPath(this,&p,rect,indexPath,selected);
+            p.restore();
+        }
+    }
+    if(instrumented){
+        recordPhase(frameStats.paintMicroseconds,"paint",clock);
+        finishFrame();
+    }
     QWidget::paintEvent(event);
 }
 
-void WTableView::onScrollBarValueChanged(int value)
+void WTableView::mouseMoveEvent(QMouseEvent *event)
 {
-    if(currentY == value || value > bar->maximum() || value < 0) return;
-    renderStartFromIndexPath();
-    bar->raise();
-    emit tableViewScrollToY(value);
-    if(value == 0 && delegate){
-        delegate->tableViewDidScrollToTop(this);
-    }else if (value == bar->maximum() && delegate) {
-        delegate->tableViewDidScrollToBottom(this);
+    if(renderMode == WTableViewRenderModePainted && indexPathForRowAtPoint(event->pos()) != hoveredIndexPath){
+        scheduleUpdates(PendingRender);
+    }
+    QWidget::mouseMoveEvent(event);
+}
+
+// presses on a painted row, the row gets its cell widget and the event is handled as if it had hit the cell
+void WTableView::mousePressEvent(QMouseEvent *event)
+{
+    if(renderMode == WTableViewRenderModePainted && event->button() == Qt::LeftButton){
+        WIndexPath indexPath = indexPathForRowAtPoint(event->pos());
+        if(indexPath.isValid()){
+            hoveredIndexPath = indexPath;
+            scheduleUpdates(PendingRender);
+            flushPendingUpdates();
+            WTableViewCell *cell = cellForRowAtIndexPath(indexPath);
+            if(cell){
+                pressedIndexPath = indexPath;
+                onTableViewCellPressed(cell);
+            }
+        }
+    }
+    QWidget::mousePressEvent(event);
+}
+
+void WTableView::mouseReleaseEvent(QMouseEvent *event)
+{
+    if(event->button() == Qt::LeftButton && pressedIndexPath.isValid()){
+        WTableViewCell *cell = cellForRowAtIndexPath(pressedIndexPath);
+        if(cell && cell->geometry().contains(event->pos())){
+            onSelectTableViewCell(cell);
+        }
+        pressedIndexPath.setNull();
+    }
+    QWidget::mouseReleaseEvent(event);
+}
+
+void WTableView::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    if(renderMode == WTableViewRenderModePainted && event->button() == Qt::LeftButton){
+        WTableViewCell *cell = cellForRowAtIndexPath(indexPathForRowAtPoint(event->pos()));
+        if(cell){
+            onTabbleViewDoubleClickCell(cell);
+        }
     }
+    QWidget::mouseDoubleClickEvent(event);
+}
+
+// the bar is only moved by the user here, the table moves it with its signals blocked
+void WTableView::onScrollBarValueChanged(int value)
+{
+    if(value > bar->maximum() || value < 0) return;
+    qint64 offset = offsetForBarValue(value);
+    if(offset == contentY) return;
+    contentY = offset;
+    scheduleUpdates(PendingScroll);
 }
 
 void WTableView::onSelectTableViewHeader(WTableViewHeader *header)
 {
-    int index = showingHeaders.key(header,-1);
+    int index = showingHeaderSections.value(header,-1);
     if(index >= 0){
         delegate->tableViewDidSelectHeaderAtSection(this,index);
     }
@@ -627,10 +1426,10 @@ void WTableView::onSelectTableViewHeader(WTableViewHeader *header)
 
 void WTableView::onSelectTableViewCell(WTableViewCell *cell)
 {
-    WIndexPath indexPath = showingCells.key(cell,WIndexPath(-1,-1));
+    WIndexPath indexPath = showingCellIndexPaths.value(cell,WIndexPath(-1,-1));
     if(indexPath.section >=0 && allowSelection){
         if(allowMultipleSelection){
-            if(selectedIndexPaths.contains(indexPath)){
+            if(selection->contains(indexPath)){
                 delegate->tableViewDidDeselectRowAtIndexPath(this,indexPath);
             }else {
                 delegate->tableViewDidSelectRowAtIndexPath(this,indexPath);
@@ -644,7 +1443,7 @@ void WTableView::onSelectTableViewCell(WTableViewCell *cell)
 
 void WTableView::onTabbleViewDoubleClickCell(WTableViewCell *cell)
 {
-    WIndexPath indexPath = showingCells.key(cell,WIndexPath(-1,-1));
+    WIndexPath indexPath = showingCellIndexPaths.value(cell,WIndexPath(-1,-1));
     if(indexPath.section >= 0){
         delegate->tableViewDoubleClickRowAtIndexPath(this,indexPath);
     }
@@ -652,17 +1451,17 @@ void WTableView::onTabbleViewDoubleClickCell(WTableViewCell *cell)
 
 void WTableView::onTableViewCellPressed(WTableViewCell *cell)
 {
-    WIndexPath indexPath = showingCells.key(cell,WIndexPath(-1,-1));
+    WIndexPath indexPath = showingCellIndexPaths.value(cell,WIndexPath(-1,-1));
     if(indexPath.section >=0 && allowSelection){
         if(allowMultipleSelection){
-            if(selectedIndexPaths.contains(indexPath)){
-                selectedIndexPaths.removeAll(indexPath);
+            if(selection->contains(indexPath)){
+                selection->deselectRows(indexPath.section,indexPath.row,indexPath.row);
 //                renderStartFromIndexPath();
                 if(cell){
                     cell->setSelected(false);
                 }
             }else {
-                selectedIndexPaths.push_back(indexPath);
+                selection->selectRows(indexPath.section,indexPath.row,indexPath.row);
 //                renderStartFromIndexPath();
                 if(cell){
                     cell->setSelected(true);
@@ -681,16 +1480,38 @@ void WTableView::onTableViewCellPressed(WTableViewCell *cell)
             selectedIndexPath = indexPath;
         }
         delegate->tableViewDidPressRowAtIndexPath(this,indexPath);
+        if(renderMode == WTableViewRenderModePainted){
+            scheduleUpdates(PendingRender);
+        }
     }
 }
 
-void WTableView::renderStartFromIndexPath(const WIndexPath &iP)
+// cells are only requested for rows intersecting the exposed band, rows outside of it are expected to be
+// showing already. a full render exposes the whole viewport
+void WTableView::renderStartFromIndexPath(qint64 exposedTop, qint64 exposedBottom)
 {
-    if(!delegate) return;
-    int value = bar->value();
+    if(!delegate || updatesDepth > 0) return;
+    QElapsedTimer clock;
+    if(instrumented){
+        clock.start();
+    }
+    if(measureRowsNearViewport()){
+        // rows moved under the blitted pixels
+        exposedTop = LLONG_MIN;
+        exposedBottom = LLONG_MAX;
+    }
+    if(instrumented){
+        recordPhase(frameStats.layoutMicroseconds,"measure",clock);
+        clock.restart();
+    }
+    qint64 value = contentY;
+    qint64 bottom = value + this->height();
+    bool fullRender = exposedTop <= value && exposedBottom >= bottom;
+    exposedTop = qMax(exposedTop,value);
+    exposedBottom = qMin(exposedBottom,bottom);
 
     if(tableFooterView){
-        tableFooterView->move(0,tableFooterViewY - value);
+        tableFooterView->move(0,viewY(tableFooterViewY - value));
         if(!(tableFooterView->y() > this->height() || tableFooterView->y() + tableFooterView->height() < 0)){
             tableFooterView->show();
 //            tableFooterView->setFixedSize(bar->isHidden() ?  this->width() :this->width()- bar->width(),tableFooterView->height());
@@ -700,73 +1521,63 @@ void WTableView::renderStartFromIndexPath(const WIndexPath &iP)
         }
     }
 
-    QVector<WIndexPath> cellIndexPaths;
+    if(renderMode == WTableViewRenderModePainted){
+        hoveredIndexPath = underMouse() ? indexPathForRowAtPoint(mapFromGlobal(QCursor::pos())) : WIndexPath(-1,-1);
+    }
+    WIndexPath firstRow = layout->firstRowFromY(value);
+    if(firstRow.isValid() && layout->rowY(firstRow) >= bottom){
+        firstRow.setNull();
+    }
 
     for(WIndexPath indexPath:showingCells.keys()){
         WTableViewCell *cell = showingCells.value(indexPath);
-        cell->hide();
-        int y = cellYs.at(indexPath.section)->at(indexPath.row);
-        int height = cellHeights.at(indexPath.section)->at(indexPath.row);
-        cell->move(0,y - value);
-        if(!(cell->y() > this->height() || cell->y() + cell->height() < 0)){
-            cellIndexPaths.push_back(indexPath);
+        qint64 y = layout->rowY(indexPath);
+        int height = layout->rowHeight(indexPath);
+        cell->move(cellX(indexPath),viewY(y - value));
+        if(y < bottom && y + height > value && needsCellWidget(indexPath)){
             setCellSelectionState(cell,indexPath);
 //            cell->setFixedSize(bar->isHidden() ?  this->width() :this->width()- bar->width(),height);
-            cell->setFixedSize(this->width(),height);
+            cell->setFixedSize(cellWidth(indexPath),height);
             cell->show();
         }else {
-            showingCells.remove(indexPath);
+            recycleCell(cell);
+            unregisterCell(indexPath);
         }
     }
 
 
-    for(int i = iP.section;i < cellHeights.size(); i++){
-        QList<int> *heights = cellHeights.at(i);
-        if(heights->size()){
-            for(int j = iP.row; j < heights->size(); j ++){
-                WIndexPath indexPath(i,j);
-                int y = cellYs.at(i)->at(j);
-                int height = heights->at(j);
-                if(((y - value) >= 0 && (y - value) < this->height()) || ((y - value + height) >=0 && (y - value + height) < this->height()) || ((y - value) <= 0 && (y - value + height) >= this->height())){
-                    if(!cellIndexPaths.contains(indexPath)){
-                        WTableViewCell *cell = delegate->tableViewCellForRowAtIndex(this,indexPath);
-                        if(cell == nullptr) continue;// to be deleted
-                        Q_ASSERT_X(cell,"WTableView","render-WTableViewCell");
-                        storeCell(cell);
-                        setCellSelectionState(cell,indexPath);
-                        showingCells.insert(indexPath,cell);
-//                        cell->setFixedSize(bar->isHidden() ?  this->width() :this->width()- bar->width(),height);
-                        cell->setFixedSize(this->width(),height);
-                        cell->move(0,y - value);
-                        cell->setFixedHeight(height);
-                        cell->show();
-                    }
-                }
-            }
+    // only the rows between the first one ending below the top of the band and the bottom of the band are visited
+    for(WIndexPath indexPath = layout->firstRowFromY(exposedTop); indexPath.isValid(); indexPath = layout->nextIndexPath(indexPath)){
+        qint64 y = layout->rowY(indexPath);
+        if(y >= exposedBottom) break;
+        if(instrumented){
+            frameStats.rowsVisited ++;
         }
+        if(showingCells.contains(indexPath) || !needsCellWidget(indexPath)) continue;
+        showCellForRowAtIndexPath(indexPath,value);
+    }
+    // the row under the cursor changes while scrolling, it may lie outside of the band
+    if(renderMode == WTableViewRenderModePainted && hoveredIndexPath.isValid() && !showingCells.contains(hoveredIndexPath)){
+        showCellForRowAtIndexPath(hoveredIndexPath,value);
     }
 
-    QList<int> headerIndexs;
     for(int i:showingHeaders.keys()){
         WTableViewHeader *header = showingHeaders.value(i);
-        header->hide();
-        int y = headerYs.at(i);
-        int height = headerHeights.at(i);
+        qint64 y = layout->headerY(i);
+        int height = layout->headerHeight(i);
 //        header->setFixedSize(bar->isHidden() ?  this->width() :this->width()- bar->width(),height);
         header->setFixedSize(this->width(),height);
-        header->move(0,y - value);
+        header->move(0,viewY(y - value));
 
         if(!(header->y() > this->height() || header->y() + header->height() < 0)){
-            headerIndexs.push_back(i);
             header->show();
             header->raise();
             if(tableViewStyle == WTableViewStylePlain){
-                if(!showingCells.isEmpty()){
-                    WIndexPath indexPath = showingCells.firstKey();
+                if(firstRow.isValid()){
+                    WIndexPath indexPath = firstRow;
                     if(i == indexPath.section){
-                        int cellHeight = cellHeights.at(indexPath.section)->last();
-                        int cellY = cellYs.at(indexPath.section)->last();
-                        int offset = cellHeight + cellY - value - header->height();
+                        qint64 sectionBottom = layout->headerY(indexPath.section) + layout->sectionHeight(indexPath.section);
+                        qint64 offset = sectionBottom - value - header->height();
                         if(offset > 0 && y - value < 0){
                             header->move(0,0);
                         }
@@ -774,80 +1585,88 @@ void WTableView::renderStartFromIndexPath(const WIndexPath &iP)
                 }
             }
         }else {
-            if(tableViewStyle == WTableViewStylePlain && !showingCells.isEmpty()){
-                WIndexPath indexPath = showingCells.firstKey();
+            if(tableViewStyle == WTableViewStylePlain && firstRow.isValid()){
+                WIndexPath indexPath = firstRow;
                 if(i == indexPath.section){
-                    int cellHeight = cellHeights.at(indexPath.section)->last();
-                    int cellY = cellYs.at(indexPath.section)->last();
-                    int height = headerHeights.at(i);
-                    int offset = cellHeight + cellY - value - height;
+                    qint64 sectionBottom = layout->headerY(indexPath.section) + layout->sectionHeight(indexPath.section);
+                    int height = layout->headerHeight(i);
+                    qint64 offset = sectionBottom - value - height;
                     if(offset > 0 && y - value < 0){
                         header->move(0,0);
 //                        header->setFixedSize(bar->isHidden() ?  this->width() :this->width()- bar->width(),height);
                         header->setFixedSize(this->width(),height);
-                        headerIndexs.push_back(i);
                         header->show();
                         header->raise();
                     }else if(- offset <= header->height()){
-                        header->move(0,offset);
+                        header->move(0,viewY(offset));
 //                        header->setFixedSize(bar->isHidden() ?  this->width() :this->width()- bar->width(),height);
                         header->setFixedSize(this->width(),height);
-                        headerIndexs.push_back(i);
                         header->show();
                         header->raise();
                     }else {
-                        showingHeaders.remove(i);
+                        recycleHeader(header);
+                        unregisterHeader(i);
                     }
                 }else {
-                    showingHeaders.remove(i);
+                    recycleHeader(header);
+                    unregisterHeader(i);
                 }
             }else {
-                showingHeaders.remove(i);
+                recycleHeader(header);
+                unregisterHeader(i);
             }
         }
     }
 
-    for(int i = iP.section;i < headerHeights.size() ;i ++){
-        int y = headerYs.at(i);
-        int height = headerHeights.at(i);
-        if(!headerIndexs.contains(i)){
+    for(int i = layout->firstSectionFromY(value);i < layout->numberOfSections() ;i ++){
+        qint64 y = layout->headerY(i);
+        if(y >= bottom) break;
+        int height = layout->headerHeight(i);
+        if(!showingHeaders.contains(i)){
 
             if(((y - value) >= 0 && (y - value) < this->height()) || ((y - value + height) >=0 && (y - value + height) < this->height())){
+                if(instrumented){
+                    frameStats.headerRequests ++;
+                }
                 WTableViewHeader *header = delegate->tableViewViewForHeaderInSection(this,i);
                 if(header == nullptr) continue;
-                storeHeader(header);
+                headerPool.claim(header);
 //                Q_ASSERT_X(header,"WTableView","render-WTableViewHeader");
-                showingHeaders.insert(i,header);
-                header->move(0,y - value);
+                registerHeader(i,header);
+                header->move(0,viewY(y - value));
 //                header->setFixedSize(bar->isHidden() ?  this->width() :this->width()- bar->width(),height);
                 header->setFixedSize(this->width() ,height);
                 header->show();
                 header->raise();
             }else {
                 if(tableViewStyle == WTableViewStylePlain){
-                    if(!showingCells.isEmpty()){
-                        WIndexPath indexPath = showingCells.firstKey();
+                    if(firstRow.isValid()){
+                        WIndexPath indexPath = firstRow;
                         if(i == indexPath.section){
+                            if(instrumented){
+                                frameStats.headerRequests ++;
+                            }
                             WTableViewHeader *header = delegate->tableViewViewForHeaderInSection(this,i);
                             if(header == nullptr) continue;
-                            storeHeader(header);
-                            int cellHeight = cellHeights.at(indexPath.section)->last();
-                            int cellY = cellYs.at(indexPath.section)->last();
-                            int offset = cellHeight + cellY - value - header->height();
+                            headerPool.claim(header);
+                            qint64 sectionBottom = layout->headerY(indexPath.section) + layout->sectionHeight(indexPath.section);
+                            qint64 offset = sectionBottom - value - header->height();
                             if(offset > 0 && y - value < 0){
                                 header->move(0,0);
-                                showingHeaders.insert(i,header);
+                                registerHeader(i,header);
 //                                header->setFixedSize(bar->isHidden() ?  this->width() :this->width()- bar->width(),height);
                                 header->setFixedSize(this->width(),height);
                                 header->show();
                                 header->raise();
                             }else if (-offset <= header->height()) {
-                                header->move(0,offset);
+                                header->move(0,viewY(offset));
 //                                header->setFixedSize(bar->isHidden() ?  this->width() :this->width()- bar->width(),height);
                                 header->setFixedSize(this->width(),height);
-                                showingHeaders.insert(i,header);
+                                registerHeader(i,header);
                                 header->show();
                                 header->raise();
+                            }else {
+                                recycleHeader(header);
                             }
                         }
                     }
@@ -856,51 +1675,444 @@ void WTableView::renderStartFromIndexPath(const WIndexPath &iP)
         }
     }
     currentY = value;
-
+    if(renderMode == WTableViewRenderModePainted && fullRender){
+        update();
+    }
+    if(prefetchDelegate){
+        prefetchTimer->start();
+    }
+    if(instrumented){
+        recordPhase(frameStats.renderMicroseconds,"render",clock);
+    }
 }
 
 void WTableView::updateContent()
 {
     if(!delegate) return;
     cleanData();
-    int y = 0;
+    layout->setColumns(columnsForWidth(this->width()));
+    measureTimer->stop();
     int section = delegate->numberOfSectionsInTableView(this);
     for(int i = 0; i < section ; i ++){
         int sectionHeight = delegate->tableViewHeightForHeaderInSection(i);
-        headerHeights.push_back(sectionHeight);
-        headerYs.push_back(y);
-        y += sectionHeight;
-
         int rows = delegate->tableViewNumberOfRowsInSection(this,i);
-        QList<int> *sectionCellheights = new QList<int>();
-        QList<int> *sectionCellYs = new QList<int>();
+        int uniformHeight = uniformRowHeightForSection(i);
+        if(uniformHeight > 0){
+            layout->appendSection(sectionHeight,rows,uniformHeight);
+            continue;
+        }
+        QVector<int> rowHeights(rows);
+        QVector<bool> estimated(rows);
         for(int j = 0;j < rows; j ++){
-            int rowHeight = delegate->tableViewHeightForRowAtIndexPath(this,WIndexPath(i,j));
-            sectionCellheights->push_back(rowHeight);
-
-            sectionCellYs->push_back(y);
-            y += rowHeight;
-//            qDebug()<<"rowHeight:"<<rowHeight<<"===contentHeight:"<<y;
-
+            WIndexPath indexPath(i,j);
+            rowHeights[j] = estimatedHeightForRowAtIndexPath(indexPath);
+            estimated[j] = rowHeights.at(j) > 0;
+            if(!estimated.at(j)){
+                rowHeights[j] = heightForRowAtIndexPath(indexPath);
+            }
         }
-        cellHeights.push_back(sectionCellheights);
-        cellYs.push_back(sectionCellYs);
+        layout->appendSection(sectionHeight,rowHeights,estimated);
+    }
 
+    updateContentHeight();
+    if(selfSizingCells && layout->estimatedRowCount()){
+        measureTimer->start(0);
     }
+}
+
+// the grid mode overrides the uniform heights of the delegate
+int WTableView::uniformRowHeightForSection(int section)
+{
+    if(!gridItemSize.isEmpty()) return gridItemSize.height();
+    return delegate->tableViewUniformRowHeightForSection(this,section);
+}
 
-    contentHeight = y;
+int WTableView::columnsForWidth(int width)
+{
+    if(gridItemSize.isEmpty()) return 1;
+    return qMax(1,width / gridItemSize.width());
+}
+
+// the columns share the width of the view, the remainder of the division is spread over them
+int WTableView::cellX(const WIndexPath &indexPath)
+{
+    int columns = layout->getColumns();
+    return int(qint64(indexPath.row % columns) * this->width() / columns);
+}
+
+int WTableView::cellWidth(const WIndexPath &indexPath)
+{
+    int columns = layout->getColumns();
+    return int(qint64(indexPath.row % columns + 1) * this->width() / columns) - cellX(indexPath);
+}
+
+void WTableView::updateContentHeight()
+{
+    contentHeight = layout->contentHeight();
     if(tableFooterView){
         tableFooterViewY = contentHeight;
         contentHeight += tableFooterView->height();
     }
+}
+
+// rows that are not uniform are measured by the delegate, or on a configured cell in the self-sizing mode
+int WTableView::heightForRowAtIndexPath(const WIndexPath &indexPath)
+{
+    if(!selfSizingCells){
+        if(instrumented){
+            frameStats.heightRequests ++;
+        }
+        return delegate->tableViewHeightForRowAtIndexPath(this,indexPath);
+    }
+    if(instrumented){
+        frameStats.heightRequests ++;
+        frameStats.cellRequests ++;
+    }
+    WTableViewCell *cell = delegate->tableViewCellForRowAtIndex(this,indexPath);
+    if(cell == nullptr) return 0;
+    if(cellPool.claim(cell) && instrumented){
+        frameStats.cellsCreated ++;
+    }
+    int width = cellWidth(indexPath);
+    int height = cell->hasHeightForWidth() ? cell->heightForWidth(width) : cell->sizeHint().height();
+    recycleCell(cell);
+    if(height < 0){
+        // the cell has no layout to size it
+        height = delegate->tableViewHeightForRowAtIndexPath(this,indexPath);
+    }
+    return height;
+}
+
+// self-sized heights are kept on the row in the layout for the content version and the cell width,
+// rows that are not in the layout yet are new and always measured
+int WTableView::cachedHeightForRowAtIndexPath(const WIndexPath &indexPath)
+{
+    if(!selfSizingCells) return heightForRowAtIndexPath(indexPath);
+    quint64 version = delegate->tableViewContentVersionForRowAtIndexPath(this,indexPath);
+    int width = cellWidth(indexPath);
+    int height = layout->cachedRowHeight(indexPath,version,width);
+    if(height >= 0) return height;
+    height = heightForRowAtIndexPath(indexPath);
+    layout->cacheRowHeight(indexPath,version,width,height);
+    return height;
+}
+
+// 0 if the row is measured right away. self-sizing rows are always estimated,
+// measureEstimatedRows sizes them while the event loop is idle
+int WTableView::estimatedHeightForRowAtIndexPath(const WIndexPath &indexPath)
+{
+    int height = delegate->tableViewEstimatedHeightForRowAtIndexPath(this,indexPath);
+    if(height <= 0 && selfSizingCells){
+        height = SelfSizingEstimatedRowHeight;
+    }
+    return height;
+}
+
+// moves visible cells and the single selection to the index paths returned by map, cells mapped to a
+// invalid index path go back to the reuse pool. the multiple selection is shifted by the callers
+void WTableView::remapRows(const std::function<WIndexPath(const WIndexPath &)> &map)
+{
+    QHash<WIndexPath,WTableViewCell *> cells;
+    for(QHash<WIndexPath,WTableViewCell *>::const_iterator it = showingCells.constBegin(); it != showingCells.constEnd(); ++it){
+        WIndexPath indexPath = map(it.key());
+        if(indexPath.isValid()){
+            cells.insert(indexPath,it.value());
+            showingCellIndexPaths.insert(it.value(),indexPath);
+        }else {
+            recycleCell(it.value());
+            showingCellIndexPaths.remove(it.value());
+        }
+    }
+    showingCells = cells;
+
+    if(selectedIndexPath.isValid()){
+        selectedIndexPath = map(selectedIndexPath);
+        if(!selectedIndexPath.isValid()){
+            selectedIndexPath.setNull();
+        }
+    }
 
+    QVector<WIndexPath> prefetching;
+    for(const WIndexPath &indexPath:prefetchingIndexPaths){
+        WIndexPath mapped = map(indexPath);
+        if(mapped.isValid()){
+            prefetching.push_back(mapped);
+        }
+    }
+    std::sort(prefetching.begin(),prefetching.end());
+    prefetchingIndexPaths = prefetching;
+}
+
+void WTableView::remapHeaders(const std::function<int(int)> &map)
+{
+    QHash<int,WTableViewHeader *> headers;
+    for(QHash<int,WTableViewHeader *>::const_iterator it = showingHeaders.constBegin(); it != showingHeaders.constEnd(); ++it){
+        int section = map(it.key());
+        if(section >= 0){
+            headers.insert(section,it.value());
+            showingHeaderSections.insert(it.value(),section);
+        }else {
+            recycleHeader(it.value());
+            showingHeaderSections.remove(it.value());
+        }
+    }
+    showingHeaders = headers;
+}
+
+// the velocity is smoothed over the scroll events of a gesture and restarts after a pause
+void WTableView::trackScrollVelocity(qint64 value)
+{
+    qint64 elapsed = scrollClock.isValid() ? scrollClock.restart() : -1;
+    if(elapsed < 0){
+        scrollClock.start();
+    }
+    qreal velocity = qreal(value - currentY) / qMax<qint64>(elapsed,1);
+    if(elapsed < 0 || elapsed > 100 || (velocity > 0) != (scrollVelocity > 0)){
+        scrollVelocity = velocity;
+    }else {
+        scrollVelocity = (scrollVelocity + velocity) / 2;
+    }
+}
+
+// runs once the frame is rendered. the prefetch window lies past the viewport edge the table scrolls
+// towards, prefetchDistance pixels deep plus the distance covered in the next 300ms at the current
+// velocity, capped at 4 times prefetchDistance
+void WTableView::updatePrefetch()
+{
+    if(!delegate || !prefetchDelegate || updatesDepth > 0) return;
+    QVector<WIndexPath> indexPaths;
+    if(prefetchDistance > 0){
+        qreal velocity = scrollClock.isValid() && scrollClock.elapsed() <= 100 ? scrollVelocity : 0;
+        int ahead = prefetchDistance + qMin(int(qAbs(velocity) * 300),3 * prefetchDistance);
+        qint64 value = contentY;
+        qint64 start = value + this->height();
+        qint64 end = start + ahead;
+        if(scrollVelocity < 0){
+            start = value - ahead;
+            end = value;
+        }
+        for(WIndexPath indexPath = layout->firstRowFromY(start); indexPath.isValid(); indexPath = layout->nextIndexPath(indexPath)){
+            if(layout->rowY(indexPath) >= end) break;
+            if(!showingCells.contains(indexPath)){
+                indexPaths.push_back(indexPath);
+            }
+        }
+    }
+
+    QVector<WIndexPath> added;
+    for(const WIndexPath &indexPath:indexPaths){
+        if(!std::binary_search(prefetchingIndexPaths.constBegin(),prefetchingIndexPaths.constEnd(),indexPath)){
+            added.push_back(indexPath);
+        }
+    }
+    QVector<WIndexPath> removed;
+    for(const WIndexPath &indexPath:prefetchingIndexPaths){
+        // rows that became visible were consumed, not cancelled
+        if(!showingCells.contains(indexPath) && !std::binary_search(indexPaths.constBegin(),indexPaths.constEnd(),indexPath)){
+            removed.push_back(indexPath);
+        }
+    }
+    prefetchingIndexPaths = indexPaths;
+    if(!removed.isEmpty()){
+        prefetchDelegate->tableViewCancelPrefetchingForRowsAtIndexPaths(this,removed);
+    }
+    if(!added.isEmpty()){
+        prefetchDelegate->tableViewPrefetchRowsAtIndexPaths(this,added);
+    }
+}
+
+void WTableView::commitUpdates()
+{
+    if(updatesDepth > 0) return;
+    scheduleUpdates(PendingRender | PendingScrollBar);
+}
+
+void WTableView::scheduleUpdates(quint8 updates)
+{
+    pendingUpdates |= updates;
+    if(!flushScheduled && !flushing && updatesDepth == 0 && pendingUpdates){
+        flushScheduled = true;
+        QMetaObject::invokeMethod(this,"flushPendingUpdates",Qt::QueuedConnection);
+    }
+}
+
+// rebuilds a pending layout index now, queries must not see the content of the previous reload
+void WTableView::ensureContent()
+{
+    if(pendingUpdates & PendingContent){
+        pendingUpdates &= ~(PendingContent | PendingRowHeights);
+        updateContent();
+    }else if(pendingUpdates & PendingRowHeights){
+        pendingUpdates &= ~PendingRowHeights;
+        invalidateRowHeights();
+    }else {
+        return;
+    }
+    updateScrollBar();
+    scheduleUpdates(PendingRender);
+}
+
+// after a width change the current row heights are kept as estimates, the render measures the rows near the
+// viewport. a self-sizing or fully measured table measures the others in the background once the resize
+// settles, an estimated one keeps measuring rows as they come near the viewport
+void WTableView::invalidateRowHeights()
+{
+    if(!delegate) return;
+    bool measureAll = selfSizingCells || layout->estimatedRowCount() == 0;
+    WIndexPath anchor = layout->firstRowFromY(contentY);
+    qint64 anchorOffset = anchor.isValid() ? layout->rowY(anchor) - contentY : 0;
+    for(int i = 0; i < layout->numberOfSections(); i ++){
+        int uniformHeight = uniformRowHeightForSection(i);
+        if(uniformHeight > 0){
+            layout->setRowHeights(i,uniformHeight);
+        }else {
+            layout->invalidateRowHeights(i);
+        }
+    }
+    if(anchor.isValid()){
+        qint64 shift = layout->rowY(anchor) - anchorOffset - contentY;
+        contentY += shift;
+        currentY += shift;
+        scrollPosition += shift;
+    }
+    updateContentHeight();
+    rowCache->clear();
+    if(measureAll && layout->estimatedRowCount()){
+        measureTimer->start(ResizeSettleInterval);
+    }
+}
+
+// measures estimated rows from the top of the content for about 4ms, the first visible row keeps its position
+// on screen so the visible cells do not move
+void WTableView::measureEstimatedRows()
+{
+    if(!delegate) return;
+    if(updatesDepth > 0 || (pendingUpdates & (PendingContent | PendingRowHeights))){
+        measureTimer->start(0);
+        return;
+    }
+    WIndexPath anchor = layout->firstRowFromY(contentY);
+    qint64 anchorOffset = anchor.isValid() ? layout->rowY(anchor) - contentY : 0;
+    QElapsedTimer clock;
+    clock.start();
+    if(instrumented){
+        frameOpen = true;
+    }
+    bool visible = false;// a row in the viewport was not rendered yet
+    WIndexPath indexPath = layout->firstEstimatedRow();
+    while(indexPath.isValid() && clock.elapsed() < 4){
+        qint64 y = layout->rowY(indexPath);
+        visible = visible || (y < contentY + this->height() && y + layout->rowHeight(indexPath) > contentY);
+        layout->setRowHeight(indexPath,cachedHeightForRowAtIndexPath(indexPath));
+        indexPath = layout->firstEstimatedRow();
+    }
+    if(anchor.isValid()){
+        qint64 shift = layout->rowY(anchor) - anchorOffset - contentY;
+        contentY += shift;
+        currentY += shift;
+        scrollPosition += shift;
+    }
+    updateContentHeight();
+    updateScrollBar();
+    if(instrumented){
+        recordPhase(frameStats.layoutMicroseconds,"measure",clock);
+    }
+    if(visible){
+        scheduleUpdates(PendingRender);
+    }
+    if(indexPath.isValid()){
+        measureTimer->start(0);
+    }
+}
+
+// all the scroll, layout and geometry work requested since the last flush is done here in one pass,
+// the scroll signal and the delegate scroll callbacks are sent once the frame is rendered
+void WTableView::flushPendingUpdates()
+{
+    flushScheduled = false;
+    if(flushing || updatesDepth > 0 || !pendingUpdates) return;
+    flushing = true;
+    QElapsedTimer clock;
+    if(instrumented){
+        finishFrame();// the previous frame was not painted
+        frameOpen = true;
+        clock.start();
+    }
+    ensureContent();
+    if(pendingUpdates & PendingScrollBar){
+        updateScrollBar();
+    }
+    if(instrumented){
+        recordPhase(frameStats.layoutMicroseconds,"layout",clock);
+    }
+    quint8 pending = pendingUpdates;
+    pendingUpdates = 0;
+    if(pending & PendingCells){
+        for(WTableViewCell *cell:showingCells.values()){
+            recycleCell(cell);
+        }
+        for(WTableViewHeader *header:showingHeaders.values()){
+            recycleHeader(header);
+        }
+        showingCells.clear();
+        showingCellIndexPaths.clear();
+        showingHeaders.clear();
+        showingHeaderSections.clear();
+    }
+
+    qint64 previousY = currentY;
+    qint64 value = contentY;
+    qint64 delta = value - previousY;
+    if(delta != 0){
+        trackScrollVelocity(value);
+    }
+    if(pending == PendingScroll){
+        if(delta != 0 && delegate && isVisible() && qAbs(delta) < this->height()){
+            // the backing store shifts the rendered pixels and every child, only the band scrolled into view is exposed
+            scroll(0,int(-delta));
+            if(instrumented){
+                frameStats.blitted = true;
+            }
+            bar->move(this->width() - bar->width(),0);
+            if(delta > 0){
+                renderStartFromIndexPath(previousY + this->height(),value + this->height());
+            }else {
+                renderStartFromIndexPath(value,previousY);
+            }
+        }else if(delta != 0){
+            renderStartFromIndexPath();
+        }
+    }else {
+        renderStartFromIndexPath();
+    }
+    bar->raise();
+    flushing = false;
+    scheduleUpdates(0);
+
+    if(delta != 0){
+        emit tableViewScrollToY(int(qMin<qint64>(value,INT_MAX)));
+        emit tableViewScrollToOffset(value);
+        if(value == 0 && delegate){
+            delegate->tableViewDidScrollToTop(this);
+        }else if (value == maxContentOffset() && delegate) {
+            delegate->tableViewDidScrollToBottom(this);
+        }
+    }
+    checkLoadMore();
+}
 
-    renderStartFromIndexPath();
+// clamps contentY to the content and mirrors it on the scroll bar without emitting a scroll
+void WTableView::updateScrollBar()
+{
+    qint64 maximum = maxContentOffset();
+    contentY = qBound<qint64>(0,contentY,maximum);
+    bar->blockSignals(true);
     bar->move(this->width()-bar->width(),0);
     bar->resize(bar->width(),this->height());
-    bar->setPageStep(this->height());
-    if(contentHeight > this->height()){
-        bar->setMaximum(contentHeight-this->height());
+    if(maximum > 0){
+        bar->setMaximum(barValueForOffset(maximum));
+        bar->setPageStep(qMax(1,barValueForOffset(this->height())));
+        bar->setValue(barValueForOffset(contentY));
 //        bar->show();
         bar->raise();
     }else {
@@ -908,61 +2120,139 @@ void WTableView::updateContent()
         bar->setValue(0);
         bar->hide();
     }
+    bar->blockSignals(false);
 }
 
-void WTableView::cleanData()
+qint64 WTableView::maxContentOffset()
 {
-    for(QList<int> *heights : cellHeights){
-        heights->clear();
-        delete heights;
-    }
-    for(QList<int> *ys : cellYs){
-        ys->clear();
-        delete ys;
-    }
-    cellHeights.clear();
-    headerHeights.clear();
-    cellYs.clear();
-    headerYs.clear();
+    return qMax<qint64>(0,contentHeight - this->height());
+}
+
+int WTableView::barValueForOffset(qint64 offset)
+{
+    qint64 maximum = maxContentOffset();
+    if(maximum <= INT_MAX) return int(offset);
+    return int(qRound64(double(offset) / maximum * ScaledScrollBarRange));
 }
 
-void WTableView::storeCell(WTableViewCell *cell)
+qint64 WTableView::offsetForBarValue(int value)
 {
-    QString identifier = cell->identifier;
-    if(cellsMap.contains(identifier)){
+    qint64 maximum = maxContentOffset();
+    if(maximum <= INT_MAX) return value;
+    return qRound64(double(value) / ScaledScrollBarRange * maximum);
+}
 
-        QVector<WTableViewCell *> *cells = cellsMap.value(identifier);
-        if(!cells->contains(cell)){
-            cells->push_back(cell);
+// replaces estimated heights around the viewport with real ones, the first visible row keeps its
+// position on screen and the scroll bar is corrected without emitting a scroll
+bool WTableView::measureRowsNearViewport()
+{
+    if(!layout->estimatedRowCount()) return false;
+    qint64 value = contentY;
+    int margin = this->height() / 2;
+    WIndexPath anchor = layout->firstRowFromY(value);
+    qint64 anchorOffset = anchor.isValid() ? layout->rowY(anchor) - value : 0;
+    bool changed = false;
+    for(int pass = 0; pass < 3; pass ++){
+        bool measured = false;
+        qint64 bottom = value + this->height() + margin;
+        for(WIndexPath indexPath = layout->firstRowFromY(value - margin); indexPath.isValid(); indexPath = layout->nextIndexPath(indexPath)){
+            if(layout->rowY(indexPath) >= bottom) break;
+            if(layout->isRowHeightEstimated(indexPath)){
+                layout->setRowHeight(indexPath,cachedHeightForRowAtIndexPath(indexPath));
+                measured = true;
+            }
+        }
+        if(!measured) break;
+        changed = true;
+        if(anchor.isValid()){
+            value = layout->rowY(anchor) - anchorOffset;
         }
-    }else {
-        QVector<WTableViewCell *> *cells = new QVector<WTableViewCell *>();
-        cells->append(cell);
-        cellsMap.insert(identifier,cells);
     }
+    if(!changed) return false;
+
+    updateContentHeight();
+    contentY = value;
+    updateScrollBar();
+    return true;
+}
+
+void WTableView::cleanData()
+{
+    layout->clear();
 }
 
-void WTableView::storeHeader(WTableViewHeader *header)
+void WTableView::recycleCell(WTableViewCell *cell)
 {
-    QString identifier = header->identifier;
-    if(headersMap.contains(identifier)){
+    cell->hide();
+    cellPool.recycle(cell);
+}
 
-        QVector<WTableViewHeader *> *headers = headersMap.value(identifier);
-        if(!headers->contains(header)){
-            headers->push_back(header);
-        }
-    }else {
-        QVector<WTableViewHeader *> *headers = new QVector<WTableViewHeader *>();
-        headers->append(header);
-        headersMap.insert(identifier,headers);
+void WTableView::recycleHeader(WTableViewHeader *header)
+{
+    header->hide();
+    headerPool.recycle(header);
+}
+
+void WTableView::registerCell(const WIndexPath &indexPath, WTableViewCell *cell)
+{
+    showingCells.insert(indexPath,cell);
+    showingCellIndexPaths.insert(cell,indexPath);
+}
+
+void WTableView::unregisterCell(const WIndexPath &indexPath)
+{
+    showingCellIndexPaths.remove(showingCells.take(indexPath));
+}
+
+void WTableView::registerHeader(int section, WTableViewHeader *header)
+{
+    showingHeaders.insert(section,header);
+    showingHeaderSections.insert(header,section);
+}
+
+void WTableView::unregisterHeader(int section)
+{
+    showingHeaderSections.remove(showingHeaders.take(section));
+}
+
+void WTableView::showCellForRowAtIndexPath(const WIndexPath &indexPath, qint64 value)
+{
+    int height = layout->rowHeight(indexPath);
+    if(instrumented){
+        frameStats.cellRequests ++;
     }
+    WTableViewCell *cell = delegate->tableViewCellForRowAtIndex(this,indexPath);
+    if(cell == nullptr) return;// to be deleted
+    Q_ASSERT_X(cell,"WTableView","render-WTableViewCell");
+    if(cellPool.claim(cell) && instrumented){
+        frameStats.cellsCreated ++;
+    }
+    setCellSelectionState(cell,indexPath);
+    registerCell(indexPath,cell);
+//        cell->setFixedSize(bar->isHidden() ?  this->width() :this->width()- bar->width(),height);
+    cell->setFixedSize(cellWidth(indexPath),height);
+    cell->move(cellX(indexPath),viewY(layout->rowY(indexPath) - value));
+    cell->setFixedHeight(height);
+    cell->show();
+}
+
+bool WTableView::isRowSelected(const WIndexPath &indexPath)
+{
+    if(!allowSelection) return false;
+    return allowMultipleSelection ? selection->contains(indexPath) : selectedIndexPath == indexPath;
+}
+
+// in painted mode only the hovered and the selected rows are backed by a cell widget
+bool WTableView::needsCellWidget(const WIndexPath &indexPath)
+{
+    return renderMode == WTableViewRenderModeWidgets || indexPath == hoveredIndexPath || isRowSelected(indexPath);
 }
 
 void WTableView::setCellSelectionState(WTableViewCell *cell, const WIndexPath &indexPath)
 {
     if(allowSelection){
         if(allowMultipleSelection){
-            if(selectedIndexPaths.contains(indexPath)){
+            if(selection->contains(indexPath)){
                 cell->setSelected(true);
             }else {
                 cell->setSelected(false);
@@ -978,7 +2268,7 @@ void WTableView::setCellSelectionState(WTableViewCell *cell, const WIndexPath &i
 }
 
 
-WTableViewHeader::WTableViewHeader(QWidget *parent, const QString &identifier) : QWidget(parent),identifier(identifier) {
+WTableViewHeader::WTableViewHeader(QWidget *parent, const QString &identifier) : QWidget(parent),identifier(identifier),reuseKey(-1),reuseIndex(-1) {
     hidden = false;
 }
 
@@ -1042,7 +2332,9 @@ WTableViewCell::WTableViewCell(QWidget *parent, const QString &identifier) :
     selectionStyle(WTableViewCellSelectionStyleGray),
     hidden(false),
     identifier(identifier),
-    leftButtonPressed(false) {
+    leftButtonPressed(false),
+    reuseKey(-1),
+    reuseIndex(-1) {
 }
 
 void WTableViewCell::mousePressEvent(QMouseEvent *event)
@@ -1116,6 +2408,22 @@ void WTableViewCell::setSelected(bool s)
     }
 }
 
+WTableViewFrameStats::WTableViewFrameStats() :
+    frame(0),
+    rowsVisited(0),
+    cellsDequeued(0),
+    cellsCreated(0),
+    cellRequests(0),
+    heightRequests(0),
+    headerRequests(0),
+    paintRequests(0),
+    layoutMicroseconds(0),
+    renderMicroseconds(0),
+    paintMicroseconds(0),
+    blitted(false)
+{
+}
+
 bool WIndexPath::isValid() const
 {
     return row >= 0 && section >=0;
@@ -6,9 +6,21 @@
 #include <QWidget>
 #include <QScrollBar>
 #include <QMap>
+#include <QHash>
 #include <QVector>
+#include <QElapsedTimer>
+#include <QPixmap>
+#include <functional>
+#include <climits>
+#include "WTableViewReusePool.h"
 
 class WTableViewDelegate;
+class WTableViewPrefetchDelegate;
+class QTimer;
+class QFile;
+class WTableViewLayout;
+class WTableViewRowCache;
+class WTableViewSelection;
 class WIndexPath
 {
 public:
@@ -30,6 +42,10 @@ inline bool operator==(const WIndexPath &index1,const WIndexPath &index2){
     return index1.section == index2.section && index1.row == index2.row;
 }
 
+inline uint qHash(const WIndexPath &indexPath,uint seed = 0){
+    return qHash((quint64(quint32(indexPath.section)) << 32) | quint32(indexPath.row),seed);
+}
+
 inline bool operator<(const WIndexPath &index1,const WIndexPath &index2){
     if(index1.section < index2.section) return true;
     if(index1.section == index2.section){
@@ -70,6 +86,7 @@ class WTableViewCell : public QWidget
     Q_OBJECT
 
     friend class WTableView;
+    template<typename T> friend class WTableViewReusePool;
 public:
 
     typedef enum :quint8{
@@ -101,12 +118,15 @@ private:
     bool selected;
     void setSelected(bool s);
     bool leftButtonPressed;
+    int reuseKey;
+    int reuseIndex;
 };
 
 class WTableViewHeader : public QWidget
 {
     Q_OBJECT
     friend class WTableView;
+    template<typename T> friend class WTableViewReusePool;
 public:
     WTableViewHeader(QWidget *parent = 0,const QString &identifier = "");
     void hide();
@@ -120,9 +140,31 @@ protected:
 private:
     bool hidden;
     QString identifier;
+    int reuseKey;
+    int reuseIndex;
 };
 
 
+// counters and timers of one frame, a frame is one flush of the pending updates and the paint that follows it.
+// only filled while the instrumentation of the table view is enabled
+class WTableViewFrameStats
+{
+public:
+    WTableViewFrameStats();
+    qint64 frame;
+    int rowsVisited;// rows walked to render cells and to paint rows
+    int cellsDequeued;// cells handed out by the reuse pool
+    int cellsCreated;// cells the reuse pool had never seen
+    int cellRequests;// tableViewCellForRowAtIndex
+    int heightRequests;// tableViewHeightForRowAtIndexPath or a self-sizing measurement
+    int headerRequests;// tableViewViewForHeaderInSection
+    int paintRequests;// tableViewPaintRowAtIndexPath
+    qint64 layoutMicroseconds;// layout index rebuilds and row measurement
+    qint64 renderMicroseconds;// placing cells, headers and the footer
+    qint64 paintMicroseconds;
+    bool blitted;// the rendered pixels were scrolled, only the exposed band was rendered
+};
+
 class WTableView : public QWidget
 {
     Q_OBJECT
@@ -135,36 +177,118 @@ public:
         WTableViewStyleGroup
     };
 
+    // WTableViewRenderModePainted lets the delegate paint rows in tableViewPaintRowAtIndexPath,
+    // cell widgets are only created for the hovered and the selected rows
+    enum WTableViewRenderMode{
+        WTableViewRenderModeWidgets,
+        WTableViewRenderModePainted
+    };
+
     explicit WTableView(QWidget *parent = 0,WTableViewStyle tableViewStyle = WTableViewStylePlain);
+    virtual ~WTableView();
 
     WTableViewCell *dequeueReusableCellByIdentifier(const QString &identifier);
     WTableViewHeader *dequeueReusableHeaderByIdentifier(const QString &identifier);
+    int reusePoolSize();// cells and headers owned by the reuse pools, visible or not
+    int reusePoolIdleSize();// cells and headers waiting to be dequeued
     void scrollToY(int y);
     void setContentYOffset(quint32 y);
     void scrollToBottom();
     void scrollToTop();
-    QSize  contentSize();
+    QSize  contentSize();// the height is clamped to INT_MAX, see getContentHeight
     int contentOffsetY();
+    // content coordinates are 64-bit, the scroll bar range is scaled when the content is taller than 2^31 pixels
+    void setContentOffset(qint64 y);
+    qint64 contentOffset();
+    qint64 getContentHeight();
+    qint64 yForRowAtIndexPath(const WIndexPath &indexPath);// -1 if indexPath is out of range
+    qint64 yForHeaderInSection(int section);// -1 if section is out of range
     void setDelegate(WTableViewDelegate *delegate);
     WTableViewDelegate *getDelegate();
+    void setPrefetchDelegate(WTableViewPrefetchDelegate *prefetchDelegate);
+    WTableViewPrefetchDelegate *getPrefetchDelegate();
+    int getPrefetchDistance();
+    void setPrefetchDistance(int distance);// pixels prefetched ahead of the viewport at rest, it grows with the scroll velocity. 0 disables prefetching
     bool isAllowSelection();
     void setAllowSelection(bool allow);
     bool isAllowMultipleSelection();
     void setAllowMultipleSelection(bool allow);
+    WTableViewRenderMode getRenderMode();
+    void setRenderMode(WTableViewRenderMode mode);
+    qint64 getRowCacheBudget();
+    void setRowCacheBudget(qint64 bytes);// bytes of rendered rows kept in painted mode, 0 disables the cache
+    qint64 rowCacheSize();
+    bool isSmoothScrolling();
+    void setSmoothScrolling(bool smooth);// wheel notches glide and touchpad flings continue kinetically, wheel input is applied once per frame either way
+    qreal getScrollVelocity();// pixels per second, negative when scrolling up
+    bool isInstrumentationEnabled();
+    void setInstrumentationEnabled(bool enabled);// every frame emits tableViewFrameStats
+    WTableViewFrameStats getLastFrameStats();
+    // writes the phases and the counters of every frame as Chrome trace events until stopTrace,
+    // the file loads in chrome://tracing or Perfetto. enables the instrumentation
+    bool startTrace(const QString &fileName);
+    void stopTrace();
+    int getUniformRowHeight();
+    void setUniformRowHeight(int height);// 0 disables the uniform mode, sections can override it through the delegate
+    int getEstimatedRowHeight();
+    void setEstimatedRowHeight(int height);// 0 disables estimation, rows are measured before the first render
+    bool isSelfSizingCells();
+    // rows that are not uniform are measured on the cell returned by the delegate, through heightForWidth or sizeHint.
+    // heights are cached per row, content version and width, rows not cached yet are estimated and measured when idle
+    void setSelfSizingCells(bool selfSizing);
+    QSize getGridItemSize();
+    // a non empty size lays the rows of every section out in a grid, as many columns as items of that width
+    // fit in the view, stretched to share its width. rows have the item height, headers keep the full width
+    void setGridItemSize(const QSize &size);
+    int numberOfColumns();// 1 outside of the grid mode
+    // row and section changes issued between beginUpdates and endUpdates only touch the layout index,
+    // visible cells and the scroll bar are updated once by the outermost endUpdates.
+    // every index path refers to the table after the previous change of the batch
+    void beginUpdates();
+    void endUpdates();
     void reloadRowAtIndexPath(const WIndexPath &indexPath);
     void insertRowAtIndexPath(const WIndexPath &indexPath);
+    void insertRowsAtIndexPath(const WIndexPath &indexPath,int count);// count rows from indexPath, O(log N) plus the visible rows
     void insertSection(int section);
     void deleteRowAtIndexPath(const WIndexPath &indexPath);
+    void deleteRowsAtIndexPath(const WIndexPath &indexPath,int count);
+    void deleteSection(int section);
+    void moveRowAtIndexPath(const WIndexPath &fromIndexPath,const WIndexPath &toIndexPath);
+    // the count rows from fromIndexPath keep their order, toIndexPath is counted once they are taken out. O(log N)
+    void moveRowsAtIndexPath(const WIndexPath &fromIndexPath,int count,const WIndexPath &toIndexPath);
+    // streaming tail: the delegate appended count rows at the end of section, or dropped its count oldest rows,
+    // e.g. through a WTableViewRingBuffer. no other row changes index, both cost O(log N) plus the visible rows.
+    // a full buffer drops a row for every row appended, the drops are passed with the appended rows
+    void appendRows(int section,int count,int droppedFromHead = 0);
+    void removeRowsFromHead(int section,int count);
+    // pagination, tableViewLoadMoreRows is called ahead of the end of the content so the next page arrives before the user does
+    int getLoadMoreThreshold();
+    void setLoadMoreThreshold(int pixels);// distance left below the viewport, 0 disables it
+    int getLoadMoreThresholdRows();
+    void setLoadMoreThresholdRows(int rows);// rows left below the viewport, 0 disables it
+    bool isLoadingMore();
+    // appends the loaded page at the end of section in one append and allows the next call. without rows, a failed
+    // or last load, the next call waits for the next scroll or content change
+    void finishLoadingMore(int section = -1,int count = 0);
+    bool isFollowingTail();
+    void setFollowingTail(bool follow);// a table scrolled to the bottom stays there as rows are appended, on by default
     void selectedRowAtIndexPath(const WIndexPath &indexPath);
     void deselectRowAtIndexPath(const WIndexPath &indexPath);
+    // range operations only apply to the multiple selection, they cost one range per section
+    void selectAll();
+    void selectRowsInRange(const WIndexPath &fromIndexPath,const WIndexPath &toIndexPath);// both rows included
+    void invertSelection();
+    void clearSelection();
+    QVector<WIndexPath> indexPathsForSelectedRows();// one entry per selected row
+    qint64 numberOfSelectedRows();
     void setTableFooterView(QWidget *footerView);
     QWidget *getTableFooterView();
-    WIndexPath indexPathForRowAtPoint(const QPoint &);// returns a invalid indexPath if point is outside of any row in the table
+    WIndexPath indexPathForRowAtPoint(const QPoint &);// point is in view coordinates, it may lie outside of the visible cells. returns a invalid indexPath if point is outside of any row in the table
     WIndexPath indexPathForCell(WTableViewCell *cell);// returns a invalid indexPath if cell is not visible
     WTableViewCell *cellForRowAtIndexPath(const WIndexPath &indexPath);// returns empty QVector if cell is not visible or index path is out of range
     QVector<WIndexPath> indexPathsForVisibleRows();
     QVector<WTableViewCell *> visibleCells();
-    QRect rectForRowAtIndexPath(const WIndexPath &indexPath);
+    QRect rectForRowAtIndexPath(const WIndexPath &indexPath);// in content coordinates, y is clamped to INT_MAX
     QRect rectForHeaderInSection(int section);
 protected:
     void resizeEvent(QResizeEvent *event) Q_DECL_OVERRIDE;
@@ -172,45 +296,141 @@ protected:
     void enterEvent(QEvent *) Q_DECL_OVERRIDE;
     void leaveEvent(QEvent *) Q_DECL_OVERRIDE;
     void paintEvent(QPaintEvent *) Q_DECL_OVERRIDE;
+    void mouseMoveEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
+    void mousePressEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
+    void mouseReleaseEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
+    void mouseDoubleClickEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
 
 signals:
-    void tableViewScrollToY(int y);
+    void tableViewScrollToY(int y);// y is clamped to INT_MAX
+    void tableViewScrollToOffset(qint64 y);
+    void tableViewFrameStats(const WTableViewFrameStats &stats);
 public slots:
-    void refreshContent();
-    void reloadData();
+    void refreshContent();// heights and cells are requested again, the selection is kept
+    void reloadData();// keeps the reuse pool, call purgeReusePool to destroy the idle views
+    void purgeReusePool();// deletes idle cells and headers, visible ones are kept
 private slots:
     void onScrollBarValueChanged(int value);
     void onSelectTableViewHeader(WTableViewHeader *);
     void onSelectTableViewCell(WTableViewCell *);
     void onTabbleViewDoubleClickCell(WTableViewCell *);
     void onTableViewCellPressed(WTableViewCell *);
+    void updatePrefetch();
+    void measureEstimatedRows();
+    void onScrollFrame();
+    void flushPendingUpdates();
 private:
-    void renderStartFromIndexPath(const WIndexPath &indexPath = WIndexPath());
+    void renderStartFromIndexPath(qint64 exposedTop = LLONG_MIN,qint64 exposedBottom = LLONG_MAX);// band in content coordinates
+    void showCellForRowAtIndexPath(const WIndexPath &indexPath,qint64 value);
+    void registerCell(const WIndexPath &indexPath,WTableViewCell *cell);
+    void unregisterCell(const WIndexPath &indexPath);
+    void registerHeader(int section,WTableViewHeader *header);
+    void unregisterHeader(int section);
     void updateContent();
+    void remapRows(const std::function<WIndexPath(const WIndexPath &)> &map);
+    void remapHeaders(const std::function<int(int)> &map);
+    void commitUpdates();
+    void scheduleUpdates(quint8 updates);
+    void ensureContent();
+    void invalidateRowHeights();
+    void finishFrame();
+    void checkLoadMore();
+    void recordPhase(qint64 &total,const char *name,const QElapsedTimer &clock);
+    void writeTraceEvent(const QByteArray &event);
+    int uniformRowHeightForSection(int section);
+    int columnsForWidth(int width);
+    int cellX(const WIndexPath &indexPath);
+    int cellWidth(const WIndexPath &indexPath);
+    void updateContentHeight();
+    void appendLayoutRows(int section,int count);
+    void removeLayoutRowsFromHead(int section,int count);
+    int heightForRowAtIndexPath(const WIndexPath &indexPath);
+    int cachedHeightForRowAtIndexPath(const WIndexPath &indexPath);// the row must be in the layout
+    int estimatedHeightForRowAtIndexPath(const WIndexPath &indexPath);
+    void updateScrollBar();
+    qint64 maxContentOffset();
+    int barValueForOffset(qint64 offset);
+    qint64 offsetForBarValue(int value);
+    bool measureRowsNearViewport();// returns true if row heights changed
+    void trackScrollVelocity(qint64 value);
+    void stopScrolling();
     void cleanData();
-    void storeCell(WTableViewCell *cell);
-    void storeHeader(WTableViewHeader *header);
+    void recycleCell(WTableViewCell *cell);
+    void recycleHeader(WTableViewHeader *header);
     void setCellSelectionState(WTableViewCell *cell,const WIndexPath &indexPath);
+    bool isRowSelected(const WIndexPath &indexPath);
+    bool needsCellWidget(const WIndexPath &indexPath);
     QScrollBar *bar;
     QWidget *tableFooterView;
-    QMap<QString,QVector<WTableViewCell*>*> cellsMap;
-    QMap<QString,QVector<WTableViewHeader*>*> headersMap;
+    WTableViewReusePool<WTableViewCell> cellPool;
+    WTableViewReusePool<WTableViewHeader> headerPool;
     WTableViewDelegate *delegate;
-    QMap<WIndexPath,WTableViewCell *>showingCells;
-    QMap<int,WTableViewHeader *>showingHeaders;
-    QList<int>headerHeights;
-    QList<int>headerYs;
-    QList<QList<int> *>cellHeights;
-    QList<QList<int> *>cellYs;
-    int tableFooterViewY;
-    QVector<WIndexPath>selectedIndexPaths;
+    WTableViewPrefetchDelegate *prefetchDelegate;
+    QTimer *prefetchTimer;
+    QVector<WIndexPath> prefetchingIndexPaths;// sorted
+    QElapsedTimer scrollClock;
+    qreal scrollVelocity;// pixels per millisecond, negative when scrolling up
+    int prefetchDistance;
+    QTimer *measureTimer;// measures the rows a width change left estimated, one slice per event loop pass
+    QHash<WIndexPath,WTableViewCell *>showingCells;
+    QHash<WTableViewCell *,WIndexPath>showingCellIndexPaths;
+    QHash<int,WTableViewHeader *>showingHeaders;
+    QHash<WTableViewHeader *,int>showingHeaderSections;
+    WTableViewLayout *layout;
+    WTableViewRowCache *rowCache;
+    WTableViewSelection *selection;
+    qint64 tableFooterViewY;
     WTableViewStyle tableViewStyle;
     WIndexPath selectedIndexPath;
-    int currentY;
-    int contentHeight;
+    qint64 currentY;// offset of the last render
+    qint64 contentY;// offset the table is scrolled to, the scroll bar only mirrors it
+    qint64 contentHeight;
+    int uniformRowHeight;
+    int estimatedRowHeight;
+    bool selfSizingCells;
+    QSize gridItemSize;
+    bool followingTail;
+    int loadMoreThreshold;
+    int loadMoreThresholdRows;
+    bool loadingMore;
     bool allowSelection;
     bool allowMultipleSelection;
     bool isBarSliding;
+    int updatesDepth;
+    WTableViewRenderMode renderMode;
+    WIndexPath hoveredIndexPath;
+    WIndexPath pressedIndexPath;
+    QTimer *scrollTimer;
+    QElapsedTimer frameClock;
+    qreal scrollPosition;// fractional position driven by onScrollFrame
+    qreal pendingScroll;// wheel distance not applied yet
+    qreal kineticVelocity;// pixels per millisecond
+    qreal reportedVelocity;
+    bool smoothScrolling;
+    bool pixelScrolling;
+    bool scrollGesture;
+    bool systemMomentum;
+    bool kineticScrolling;
+    enum PendingUpdate : quint8{
+        PendingScroll = 1,
+        PendingRender = 2,
+        PendingScrollBar = 4,
+        PendingContent = 8,// the layout index is rebuilt from the delegate
+        PendingCells = 16,// visible cells and headers are requested again
+        PendingRowHeights = 32// the width changed, row heights are measured again
+    };
+    quint8 pendingUpdates;
+    bool flushScheduled;
+    bool flushing;
+    QPixmap committedFrame;// painted rows when the open batch began, shown until endUpdates
+    bool instrumented;
+    bool frameOpen;// counters were recorded since the last finishFrame
+    WTableViewFrameStats frameStats;
+    WTableViewFrameStats lastFrameStats;
+    qint64 frameCount;
+    QFile *traceFile;
+    QElapsedTimer traceClock;
+    bool traceEmpty;// no event written yet
 };
 
 
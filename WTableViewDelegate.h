@@ -6,6 +6,8 @@
 #include <QWidget>
 #include "WTableView.h"
 
+class QPainter;
+
 
 
 class WTableViewDelegate
@@ -16,8 +18,20 @@ public:
     virtual int tableViewNumberOfRowsInSection(WTableView *tableView,int section) = 0;
     virtual WTableViewCell *tableViewCellForRowAtIndex(WTableView *tableView,const WIndexPath &indexPath) = 0;
     virtual int tableViewHeightForRowAtIndexPath(WTableView *tableView,const WIndexPath &indexPath) = 0;
+    // return a value > 0 to give every row of the section that height without asking for it row by row
+    virtual int tableViewUniformRowHeightForSection(WTableView *tableView,int){return tableView->getUniformRowHeight();}
+    // return a value > 0 to defer tableViewHeightForRowAtIndexPath until the row comes near the viewport
+    virtual int tableViewEstimatedHeightForRowAtIndexPath(WTableView *tableView,const WIndexPath &){return tableView->getEstimatedRowHeight();}
+    // return true if row heights change with the width of the table, rows are measured again after a width change.
+    // otherwise resizing only moves the viewport
+    virtual bool tableViewRowHeightsDependOnWidth(WTableView *){return false;}
     virtual int tableViewHeightForHeaderInSection(int){return 0;}
     virtual WTableViewHeader *tableViewViewForHeaderInSection(WTableView *,int){return nullptr;}
+    // paints a row without a cell widget in WTableViewRenderModePainted, the painter is clipped to rect
+    virtual void tableViewPaintRowAtIndexPath(WTableView *,QPainter *,const QRect &,const WIndexPath &,bool){}
+    // a rendered row and a self-sized height stay cached while the version is unchanged, see WTableView::setRowCacheBudget
+    // and WTableView::setSelfSizingCells
+    virtual quint64 tableViewContentVersionForRowAtIndexPath(WTableView *,const WIndexPath &){return 0;}
     virtual void tableViewDidSelectHeaderAtSection(WTableView *,int){}
     virtual void tableViewDidSelectRowAtIndexPath(WTableView *,const WIndexPath &){}
     virtual void tableViewDidPressRowAtIndexPath(WTableView *,const WIndexPath &){}
@@ -25,8 +39,27 @@ public:
     virtual void tableViewDoubleClickRowAtIndexPath(WTableView *,const WIndexPath &){}
     virtual void tableViewDidScrollToTop(WTableView *){}
     virtual void tableViewDidScrollToBottom(WTableView *){}
+    // called once the rows left below the viewport drop under the load more threshold, it is not called again
+    // until WTableView::finishLoadingMore. see WTableView::setLoadMoreThreshold
+    virtual void tableViewLoadMoreRows(WTableView *){}
     virtual void tableViewDidScrollTo(WTableView *,int ){}
+    // pixels per second, negative when scrolling up, 0 once the scroll engine stops
+    virtual void tableViewDidChangeScrollVelocity(WTableView *,qreal){}
     virtual ~WTableViewDelegate(){}
 };
 
+// Optional companion of WTableViewDelegate, set with WTableView::setPrefetchDelegate.
+// The table view reports the rows about to scroll into view so their data can be loaded on a
+// worker thread before tableViewCellForRowAtIndex asks for them. Both calls are made on the GUI
+// thread once the frame is rendered, they should only queue the work and return.
+class WTableViewPrefetchDelegate
+{
+public:
+    WTableViewPrefetchDelegate(){}
+    virtual void tableViewPrefetchRowsAtIndexPaths(WTableView *tableView,const QVector<WIndexPath> &indexPaths) = 0;
+    // rows that left the prefetch window before becoming visible
+    virtual void tableViewCancelPrefetchingForRowsAtIndexPaths(WTableView *,const QVector<WIndexPath> &){}
+    virtual ~WTableViewPrefetchDelegate(){}
+};
+
 #endif // WTABLEVIEWDELEGATE_H
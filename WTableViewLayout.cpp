@@ -0,0 +1,969 @@
+//  Created by wangwei
+//  Copyright © 2017-03-25 ExecuteSystem. All rights reserved.
+#include "WTableViewLayout.h"
+
+WTableViewLayout::WTableViewLayout() :
+    root(-1),
+    sectionRoot(-1),
+    columns(1),
+    estimatedRows(0),
+    seed(2463534242u)
+{
+}
+
+void WTableViewLayout::clear()
+{
+    nodes.clear();
+    freeNodes.clear();
+    root = -1;
+    measures.clear();
+    freeMeasures.clear();
+    sectionNodes.clear();
+    freeSectionNodes.clear();
+    sectionRoot = -1;
+    estimatedRows = 0;
+}
+
+void WTableViewLayout::setColumns(int columns)
+{
+    Q_ASSERT_X(sectionRoot < 0,"WTableViewLayout::setColumns","the layout is not empty");
+    this->columns = qMax(columns,1);
+}
+
+int WTableViewLayout::getColumns() const
+{
+    return columns;
+}
+
+void WTableViewLayout::appendSection(int headerHeight, const QVector<int> &rowHeights, const QVector<bool> &estimated)
+{
+    if(columns > 1){
+        QVector<int> lineHeights;
+        QVector<bool> lineEstimated;
+        toLines(rowHeights,estimated,lineHeights,lineEstimated);
+        appendSectionTree(buildTree(headerHeight,lineHeights,lineEstimated),lineHeights.size() + 1,rowHeights.size());
+        return;
+    }
+    appendSectionTree(buildTree(headerHeight,rowHeights,estimated),rowHeights.size() + 1,rowHeights.size());
+}
+
+void WTableViewLayout::appendSection(int headerHeight, int rows, int rowHeight, bool estimated)
+{
+    int lines = linesForRows(rows);
+    appendSectionTree(buildTree(headerHeight,lines,rowHeight,estimated),lines + 1,rows);
+}
+
+void WTableViewLayout::insertSection(int section, int headerHeight, const QVector<int> &rowHeights, const QVector<bool> &estimated)
+{
+    if(columns > 1){
+        QVector<int> lineHeights;
+        QVector<bool> lineEstimated;
+        toLines(rowHeights,estimated,lineHeights,lineEstimated);
+        insertSectionTree(section,buildTree(headerHeight,lineHeights,lineEstimated),lineHeights.size() + 1,rowHeights.size());
+        return;
+    }
+    insertSectionTree(section,buildTree(headerHeight,rowHeights,estimated),rowHeights.size() + 1,rowHeights.size());
+}
+
+void WTableViewLayout::insertSection(int section, int headerHeight, int rows, int rowHeight, bool estimated)
+{
+    int lines = linesForRows(rows);
+    insertSectionTree(section,buildTree(headerHeight,lines,rowHeight,estimated),lines + 1,rows);
+}
+
+void WTableViewLayout::removeSection(int section)
+{
+    Q_ASSERT_X(section >= 0 && section < numberOfSections(),"WTableViewLayout::removeSection","section is out of range");
+    int l,m,r;
+    split(root,sectionStart(section),l,r);
+    split(r,sectionItemCount(section),m,r);
+    releaseTree(m);
+    root = merge(l,r);
+    splitSections(sectionRoot,section,l,r);
+    splitSections(r,1,m,r);
+    freeSectionNodes.push_back(m);
+    sectionRoot = mergeSections(l,r);
+}
+
+void WTableViewLayout::insertRow(const WIndexPath &indexPath, int height, bool estimated)
+{
+    Q_ASSERT_X(indexPath.section < numberOfSections(),"WTableViewLayout::insertRow","indexPath section is out of range");
+    Q_ASSERT_X(indexPath.row <= numberOfRowsInSection(indexPath.section),"WTableViewLayout::insertRow","indexPath row is out of range");
+    insertRows(indexPath,1,height,estimated);
+}
+
+void WTableViewLayout::insertRows(const WIndexPath &indexPath, const QVector<int> &heights, const QVector<bool> &estimated)
+{
+    if(columns > 1){
+        int height = 0;
+        for(int h:heights){
+            height = qMax(height,h);
+        }
+        insertRows(indexPath,heights.size(),height,estimated.contains(true));
+        return;
+    }
+    insertTree(indexPath,buildRuns(heights,estimated),heights.size());
+}
+
+// with columns the rows after indexPath flow to the next line, only lines at the end of the section come and go
+void WTableViewLayout::insertRows(const WIndexPath &indexPath, int rows, int height, bool estimated)
+{
+    if(rows <= 0) return;
+    if(columns > 1){
+        Q_ASSERT_X(indexPath.isValid() && indexPath.section < numberOfSections(),"WTableViewLayout::insertRows","indexPath section is out of range");
+        Q_ASSERT_X(indexPath.row <= numberOfRowsInSection(indexPath.section),"WTableViewLayout::insertRows","indexPath row is out of range");
+        resizeSectionLines(indexPath.section,numberOfRowsInSection(indexPath.section) + rows,height,estimated);
+        return;
+    }
+    insertTree(indexPath,newNode(height,rows,estimated),rows);
+}
+
+// O(log N) plus the runs removed
+void WTableViewLayout::removeRows(const WIndexPath &indexPath, int rows)
+{
+    Q_ASSERT_X(indexPath.isValid() && indexPath.section < numberOfSections(),"WTableViewLayout::removeRows","indexPath section is out of range");
+    Q_ASSERT_X(rows >= 0 && indexPath.row + rows <= numberOfRowsInSection(indexPath.section),"WTableViewLayout::removeRows","rows are out of range");
+    if(rows <= 0) return;
+    if(columns > 1){
+        resizeSectionLines(indexPath.section,numberOfRowsInSection(indexPath.section) - rows,0,false);
+        return;
+    }
+    int l,m,r;
+    split(root,sectionStart(indexPath.section) + 1 + indexPath.row,l,r);
+    split(r,rows,m,r);
+    releaseTree(m);
+    root = merge(l,r);
+    updateSection(indexPath.section,-rows,-rows);
+}
+
+// the runs of the rows move with their heights and cached measures, O(log N).
+// with columns the lines of the moved rows go from the end of one section to the end of the other
+void WTableViewLayout::moveRows(const WIndexPath &fromIndexPath, int rows, const WIndexPath &toIndexPath)
+{
+    Q_ASSERT_X(fromIndexPath.isValid() && fromIndexPath.section < numberOfSections(),"WTableViewLayout::moveRows","fromIndexPath section is out of range");
+    Q_ASSERT_X(rows >= 0 && fromIndexPath.row + rows <= numberOfRowsInSection(fromIndexPath.section),"WTableViewLayout::moveRows","rows are out of range");
+    Q_ASSERT_X(toIndexPath.isValid() && toIndexPath.section < numberOfSections(),"WTableViewLayout::moveRows","toIndexPath section is out of range");
+    Q_ASSERT_X(toIndexPath.row <= numberOfRowsInSection(toIndexPath.section) - (toIndexPath.section == fromIndexPath.section ? rows : 0),"WTableViewLayout::moveRows","toIndexPath row is out of range");
+    if(rows <= 0 || fromIndexPath == toIndexPath) return;
+    if(columns > 1){
+        if(fromIndexPath.section == toIndexPath.section) return;
+        int height = rowHeight(fromIndexPath);
+        bool estimated = isRowHeightEstimated(fromIndexPath);
+        resizeSectionLines(fromIndexPath.section,numberOfRowsInSection(fromIndexPath.section) - rows,0,false);
+        resizeSectionLines(toIndexPath.section,numberOfRowsInSection(toIndexPath.section) + rows,height,estimated);
+        return;
+    }
+    int l,m,r;
+    split(root,sectionStart(fromIndexPath.section) + 1 + fromIndexPath.row,l,r);
+    split(r,rows,m,r);
+    root = merge(l,r);
+    updateSection(fromIndexPath.section,-rows,-rows);
+    split(root,sectionStart(toIndexPath.section) + 1 + toIndexPath.row,l,r);
+    root = merge(merge(l,m),r);
+    updateSection(toIndexPath.section,rows,rows);
+}
+
+void WTableViewLayout::removeRow(const WIndexPath &indexPath)
+{
+    Q_ASSERT_X(contains(indexPath),"WTableViewLayout::removeRow","indexPath is out of range");
+    removeRows(indexPath,1);
+}
+
+// with columns the height of the line of indexPath
+void WTableViewLayout::setRowHeight(const WIndexPath &indexPath, int height)
+{
+    Q_ASSERT_X(contains(indexPath),"WTableViewLayout::setRowHeight","indexPath is out of range");
+    setItemHeight(itemForRow(indexPath),height);
+}
+
+// only rows of a single column are cached, a line of a grid has no row of its own
+int WTableViewLayout::cachedRowHeight(const WIndexPath &indexPath, quint64 version, int width) const
+{
+    if(columns > 1 || !contains(indexPath)) return -1;
+    int measure = itemAt(itemForRow(indexPath)).measure;
+    if(measure < 0 || measures.at(measure).version != version) return -1;
+    for(int i = 0; i < 2; i ++){
+        if(measures.at(measure).widths[i] == width) return measures.at(measure).heights[i];
+    }
+    return -1;
+}
+
+void WTableViewLayout::cacheRowHeight(const WIndexPath &indexPath, quint64 version, int width, int height)
+{
+    if(columns > 1 || !contains(indexPath)) return;
+    int pos = itemForRow(indexPath);
+    int t = nodeAt(pos);
+    if(nodes.at(t).repeat > 1){
+        int l,r;
+        split(root,pos,l,r);
+        split(r,1,t,r);
+        root = merge(merge(l,t),r);
+    }
+    int measure = nodes.at(t).measure;
+    if(measure < 0){
+        Measure entry;
+        entry.version = version;
+        entry.widths[0] = width;
+        entry.heights[0] = height;
+        entry.widths[1] = -1;
+        entry.heights[1] = -1;
+        if(freeMeasures.isEmpty()){
+            measures.push_back(entry);
+            nodes[t].measure = measures.size() - 1;
+        }else {
+            nodes[t].measure = freeMeasures.takeLast();
+            measures[nodes.at(t).measure] = entry;
+        }
+        return;
+    }
+    Measure &entry = measures[measure];
+    if(entry.version != version){
+        entry.version = version;
+        entry.widths[1] = -1;
+        entry.heights[1] = -1;
+    }else if(entry.widths[0] != width){
+        entry.widths[1] = entry.widths[0];
+        entry.heights[1] = entry.heights[0];
+    }
+    entry.widths[0] = width;
+    entry.heights[0] = height;
+}
+
+void WTableViewLayout::removeCachedRowHeight(const WIndexPath &indexPath)
+{
+    if(columns > 1 || !contains(indexPath)) return;
+    int t = nodeAt(itemForRow(indexPath));
+    if(nodes.at(t).measure < 0) return;
+    freeMeasures.push_back(nodes.at(t).measure);
+    nodes[t].measure = -1;
+}
+
+void WTableViewLayout::setHeaderHeight(int section, int height)
+{
+    Q_ASSERT_X(section >= 0 && section < numberOfSections(),"WTableViewLayout::setHeaderHeight","section is out of range");
+    setItemHeight(sectionStart(section),height);
+}
+
+void WTableViewLayout::setRowHeights(int section, int height)
+{
+    Q_ASSERT_X(section >= 0 && section < numberOfSections(),"WTableViewLayout::setRowHeights","section is out of range");
+    int lines = sectionItemCount(section) - 1;
+    if(lines <= 0) return;
+    int l,m,r;
+    split(root,sectionStart(section) + 1,l,r);
+    split(r,lines,m,r);
+    releaseTree(m);
+    root = merge(merge(l,newNode(height,lines)),r);
+}
+
+// O(log N), no height is queried and the runs of the section are only flagged when they are split
+void WTableViewLayout::invalidateRowHeights(int section)
+{
+    Q_ASSERT_X(section >= 0 && section < numberOfSections(),"WTableViewLayout::invalidateRowHeights","section is out of range");
+    int lines = sectionItemCount(section) - 1;
+    if(lines <= 0) return;
+    int l,m,r;
+    split(root,sectionStart(section) + 1,l,r);
+    split(r,lines,m,r);
+    estimatedRows += nodes.at(m).count - nodes.at(m).estimatedCount;
+    markEstimated(m);
+    root = merge(merge(l,m),r);
+}
+
+int WTableViewLayout::numberOfSections() const
+{
+    return sectionRoot < 0 ? 0 : sectionNodes.at(sectionRoot).count;
+}
+
+int WTableViewLayout::numberOfRowsInSection(int section) const
+{
+    if(section < 0 || section >= numberOfSections()) return 0;
+    return sectionAt(section).rows;
+}
+
+bool WTableViewLayout::contains(const WIndexPath &indexPath) const
+{
+    return indexPath.isValid() && indexPath.row < numberOfRowsInSection(indexPath.section);
+}
+
+qint64 WTableViewLayout::contentHeight() const
+{
+    return root < 0 ? 0 : nodes.at(root).sum;
+}
+
+qint64 WTableViewLayout::rowY(const WIndexPath &indexPath) const
+{
+    return prefixHeight(itemForRow(indexPath));
+}
+
+int WTableViewLayout::rowHeight(const WIndexPath &indexPath) const
+{
+    return itemAt(itemForRow(indexPath)).height;
+}
+
+bool WTableViewLayout::isRowHeightEstimated(const WIndexPath &indexPath) const
+{
+    return isItemEstimated(itemForRow(indexPath));
+}
+
+int WTableViewLayout::estimatedRowCount() const
+{
+    return estimatedRows;
+}
+
+WIndexPath WTableViewLayout::firstEstimatedRow() const
+{
+    if(root < 0 || nodes.at(root).estimatedCount == 0) return WIndexPath(-1,-1);
+    int t = root;
+    int pos = 0;
+    for(;;){
+        const Node &node = nodes.at(t);
+        if(node.lazyEstimated) break;// pos is the first item of the subtree
+        if(node.left >= 0 && nodes.at(node.left).estimatedCount){
+            t = node.left;
+            continue;
+        }
+        pos += node.left < 0 ? 0 : nodes.at(node.left).count;
+        if(node.estimated) break;
+        pos += node.repeat;
+        t = node.right;
+    }
+    int section = sectionForItem(pos);
+    return WIndexPath(section,(pos - sectionStart(section) - 1) * columns);
+}
+
+qint64 WTableViewLayout::headerY(int section) const
+{
+    return prefixHeight(sectionStart(section));
+}
+
+int WTableViewLayout::headerHeight(int section) const
+{
+    return itemAt(sectionStart(section)).height;
+}
+
+qint64 WTableViewLayout::sectionHeight(int section) const
+{
+    int start = sectionStart(section);
+    return prefixHeight(start + sectionItemCount(section)) - prefixHeight(start);
+}
+
+WIndexPath WTableViewLayout::indexPathForRowAtY(qint64 y) const
+{
+    int pos = itemAtY(y);
+    if(pos < 0) return WIndexPath(-1,-1);
+    int section = sectionForItem(pos);
+    int line = pos - sectionStart(section) - 1;
+    if(line < 0) return WIndexPath(-1,-1);
+    return WIndexPath(section,line * columns);
+}
+
+int WTableViewLayout::sectionAtY(qint64 y) const
+{
+    int pos = itemAtY(y);
+    if(pos < 0) return -1;
+    return sectionForItem(pos);
+}
+
+WIndexPath WTableViewLayout::firstRowFromY(qint64 y) const
+{
+    int pos = itemFromY(y);
+    if(pos >= itemCount()) return WIndexPath(-1,-1);
+    int section = sectionForItem(pos);
+    int line = pos - sectionStart(section) - 1;
+    if(line >= 0) return WIndexPath(section,line * columns);
+    if(numberOfRowsInSection(section)) return WIndexPath(section,0);
+    return nextIndexPath(WIndexPath(section,0));
+}
+
+int WTableViewLayout::firstSectionFromY(qint64 y) const
+{
+    int pos = itemFromY(y);
+    if(pos >= itemCount()) return numberOfSections();
+    return sectionForItem(pos);
+}
+
+WIndexPath WTableViewLayout::nextIndexPath(const WIndexPath &indexPath) const
+{
+    if(indexPath.row + 1 < numberOfRowsInSection(indexPath.section)){
+        return WIndexPath(indexPath.section,indexPath.row + 1);
+    }
+    int section = nextNonEmptySection(indexPath.section + 1);
+    if(section >= 0) return WIndexPath(section,0);
+    return WIndexPath(-1,-1);
+}
+
+int WTableViewLayout::newNode(int height, int repeat, bool estimated)
+{
+    Node node;
+    node.height = height;
+    node.repeat = repeat;
+    node.sum = qint64(height) * repeat;
+    node.count = repeat;
+    node.estimatedCount = estimated ? repeat : 0;
+    node.left = -1;
+    node.right = -1;
+    node.measure = -1;
+    node.priority = nextPriority() >> 2;
+    node.estimated = estimated;
+    node.lazyEstimated = false;
+    if(estimated){
+        estimatedRows += repeat;
+    }
+    if(!freeNodes.isEmpty()){
+        int t = freeNodes.takeLast();
+        nodes[t] = node;
+        return t;
+    }
+    nodes.push_back(node);
+    return nodes.size() - 1;
+}
+
+void WTableViewLayout::releaseTree(int t)
+{
+    if(t < 0) return;
+    push(t);
+    releaseTree(nodes.at(t).left);
+    releaseTree(nodes.at(t).right);
+    if(nodes.at(t).estimated){
+        estimatedRows -= nodes.at(t).repeat;
+    }
+    if(nodes.at(t).measure >= 0){
+        freeMeasures.push_back(nodes.at(t).measure);
+    }
+    freeNodes.push_back(t);
+}
+
+// O(1), the children of t are flagged by push. estimatedRows is counted by the caller
+void WTableViewLayout::markEstimated(int t)
+{
+    if(t < 0) return;
+    Node &node = nodes[t];
+    node.estimated = true;
+    node.estimatedCount = node.count;
+    node.lazyEstimated = true;
+}
+
+void WTableViewLayout::push(int t)
+{
+    if(!nodes.at(t).lazyEstimated) return;
+    nodes[t].lazyEstimated = false;
+    markEstimated(nodes.at(t).left);
+    markEstimated(nodes.at(t).right);
+}
+
+// an item is estimated if its run is, or if a run above it holds a lazy flag
+bool WTableViewLayout::isItemEstimated(int pos) const
+{
+    Q_ASSERT_X(pos >= 0 && pos < itemCount(),"WTableViewLayout::isItemEstimated","position is out of range");
+    int t = root;
+    for(;;){
+        const Node &node = nodes.at(t);
+        if(node.lazyEstimated) return true;
+        int leftCount = node.left < 0 ? 0 : nodes.at(node.left).count;
+        if(pos < leftCount){
+            t = node.left;
+        }else if(pos < leftCount + node.repeat){
+            return node.estimated;
+        }else {
+            pos -= leftCount + node.repeat;
+            t = node.right;
+        }
+    }
+}
+
+// builds a treap of one section in O(rows) by pushing nodes along the right spine,
+// consecutive rows with the same height share one node
+int WTableViewLayout::buildTree(int headerHeight, const QVector<int> &rowHeights, const QVector<bool> &estimated)
+{
+    QVector<int> spine;
+    for(int i = -1; i < rowHeights.size(); i ++){
+        int t;
+        if(i < 0){
+            t = newNode(headerHeight);
+        }else {
+            int repeat = 1;
+            bool e = estimated.value(i,false);
+            while(i + repeat < rowHeights.size() && rowHeights.at(i + repeat) == rowHeights.at(i) && estimated.value(i + repeat,false) == e){
+                repeat ++;
+            }
+            t = newNode(rowHeights.at(i),repeat,e);
+            i += repeat - 1;
+        }
+        int last = -1;
+        while(!spine.isEmpty() && nodes.at(spine.last()).priority < nodes.at(t).priority){
+            last = spine.takeLast();
+            pull(last);
+        }
+        nodes[t].left = last;
+        if(!spine.isEmpty()){
+            nodes[spine.last()].right = t;
+        }
+        spine.push_back(t);
+    }
+    while(spine.size() > 1){
+        pull(spine.takeLast());
+    }
+    pull(spine.first());
+    return spine.first();
+}
+
+int WTableViewLayout::buildTree(int headerHeight, int rows, int rowHeight, bool estimated)
+{
+    int t = newNode(headerHeight);
+    if(rows <= 0) return t;
+    return merge(t,newNode(rowHeight,rows,estimated));
+}
+
+// consecutive rows with the same height share one node, the runs are merged in order
+int WTableViewLayout::buildRuns(const QVector<int> &heights, const QVector<bool> &estimated)
+{
+    int tree = -1;
+    for(int i = 0; i < heights.size(); ){
+        int repeat = 1;
+        bool e = estimated.value(i,false);
+        while(i + repeat < heights.size() && heights.at(i + repeat) == heights.at(i) && estimated.value(i + repeat,false) == e){
+            repeat ++;
+        }
+        tree = merge(tree,newNode(heights.at(i),repeat,e));
+        i += repeat;
+    }
+    return tree;
+}
+
+void WTableViewLayout::insertTree(const WIndexPath &indexPath, int tree, int rows)
+{
+    Q_ASSERT_X(indexPath.isValid() && indexPath.section < numberOfSections(),"WTableViewLayout::insertRows","indexPath section is out of range");
+    Q_ASSERT_X(indexPath.row <= numberOfRowsInSection(indexPath.section),"WTableViewLayout::insertRows","indexPath row is out of range");
+    if(tree < 0) return;
+    int l,r;
+    split(root,sectionStart(indexPath.section) + 1 + indexPath.row,l,r);
+    root = merge(merge(l,tree),r);
+    updateSection(indexPath.section,rows,rows);
+}
+
+int WTableViewLayout::linesForRows(int rows) const
+{
+    return (rows + columns - 1) / columns;
+}
+
+// a line is as high as its highest row, it is estimated while one of its rows is
+void WTableViewLayout::toLines(const QVector<int> &rowHeights, const QVector<bool> &estimated, QVector<int> &lineHeights, QVector<bool> &lineEstimated) const
+{
+    int lines = linesForRows(rowHeights.size());
+    lineHeights.fill(0,lines);
+    lineEstimated.fill(false,lines);
+    for(int i = 0; i < rowHeights.size(); i ++){
+        lineHeights[i / columns] = qMax(lineHeights.at(i / columns),rowHeights.at(i));
+        lineEstimated[i / columns] = lineEstimated.at(i / columns) || estimated.value(i,false);
+    }
+}
+
+// adds lines of height at the end of section, or removes its last lines, so that they hold rows
+void WTableViewLayout::resizeSectionLines(int section, int rows, int height, bool estimated)
+{
+    int lines = sectionItemCount(section) - 1;
+    int target = linesForRows(rows);
+    updateSection(section,target - lines,rows - numberOfRowsInSection(section));
+    if(target == lines) return;
+    int l,r;
+    split(root,sectionStart(section) + 1 + qMin(lines,target),l,r);
+    if(target > lines){
+        root = merge(merge(l,newNode(height,target - lines,estimated)),r);
+    }else {
+        int m;
+        split(r,lines - target,m,r);
+        releaseTree(m);
+        root = merge(l,r);
+    }
+}
+
+int WTableViewLayout::itemForRow(const WIndexPath &indexPath) const
+{
+    return sectionStart(indexPath.section) + 1 + indexPath.row / columns;
+}
+
+void WTableViewLayout::appendSectionTree(int tree, int items, int rows)
+{
+    root = merge(root,tree);
+    sectionRoot = mergeSections(sectionRoot,newSection(items,rows));
+}
+
+void WTableViewLayout::insertSectionTree(int section, int tree, int items, int rows)
+{
+    Q_ASSERT_X(section >= 0 && section <= numberOfSections(),"WTableViewLayout::insertSection","section is out of range");
+    if(section == numberOfSections()){
+        appendSectionTree(tree,items,rows);
+        return;
+    }
+    int l,r;
+    split(root,sectionStart(section),l,r);
+    root = merge(merge(l,tree),r);
+    splitSections(sectionRoot,section,l,r);
+    sectionRoot = mergeSections(mergeSections(l,newSection(items,rows)),r);
+}
+
+void WTableViewLayout::pull(int t)
+{
+    Node &node = nodes[t];
+    node.sum = qint64(node.height) * node.repeat;
+    node.count = node.repeat;
+    node.estimatedCount = node.estimated ? node.repeat : 0;
+    if(node.left >= 0){
+        node.sum += nodes.at(node.left).sum;
+        node.count += nodes.at(node.left).count;
+        node.estimatedCount += nodes.at(node.left).estimatedCount;
+    }
+    if(node.right >= 0){
+        node.sum += nodes.at(node.right).sum;
+        node.count += nodes.at(node.right).count;
+        node.estimatedCount += nodes.at(node.right).estimatedCount;
+    }
+}
+
+// l receives the first k items of t, r the rest. A run containing the split point is cut in two,
+// the tail node inherits the priority so both halves keep the heap order.
+void WTableViewLayout::split(int t, int k, int &l, int &r)
+{
+    if(t < 0){
+        l = r = -1;
+        return;
+    }
+    push(t);
+    int left = nodes.at(t).left;
+    int leftCount = left < 0 ? 0 : nodes.at(left).count;
+    int repeat = nodes.at(t).repeat;
+    if(k <= leftCount){
+        int ll,lr;
+        split(left,k,ll,lr);
+        nodes[t].left = lr;
+        l = ll;
+        r = t;
+    }else if(k >= leftCount + repeat){
+        int rl,rr;
+        split(nodes.at(t).right,k - leftCount - repeat,rl,rr);
+        nodes[t].right = rl;
+        l = t;
+        r = rr;
+    }else {
+        int head = k - leftCount;
+        bool estimated = nodes.at(t).estimated;
+        int tail = newNode(nodes.at(t).height,repeat - head,estimated);
+        if(estimated){
+            estimatedRows -= repeat - head;
+        }
+        nodes[tail].priority = nodes.at(t).priority;
+        nodes[tail].right = nodes.at(t).right;
+        nodes[t].right = -1;
+        nodes[t].repeat = head;
+        pull(tail);
+        l = t;
+        r = tail;
+    }
+    pull(t);
+}
+
+int WTableViewLayout::merge(int l, int r)
+{
+    if(l < 0) return r;
+    if(r < 0) return l;
+    if(nodes.at(l).priority > nodes.at(r).priority){
+        push(l);
+        int right = merge(nodes.at(l).right,r);
+        nodes[l].right = right;
+        pull(l);
+        return l;
+    }
+    push(r);
+    int left = merge(l,nodes.at(r).left);
+    nodes[r].left = left;
+    pull(r);
+    return r;
+}
+
+// sum of the heights of the first pos items
+qint64 WTableViewLayout::prefixHeight(int pos) const
+{
+    int t = root;
+    qint64 y = 0;
+    while(t >= 0){
+        const Node &node = nodes.at(t);
+        int leftCount = node.left < 0 ? 0 : nodes.at(node.left).count;
+        qint64 leftSum = node.left < 0 ? 0 : nodes.at(node.left).sum;
+        if(pos <= leftCount){
+            t = node.left;
+        }else if(pos < leftCount + node.repeat){
+            return y + leftSum + qint64(pos - leftCount) * node.height;
+        }else {
+            y += leftSum + qint64(node.height) * node.repeat;
+            pos -= leftCount + node.repeat;
+            t = node.right;
+        }
+    }
+    return y;
+}
+
+const WTableViewLayout::Node &WTableViewLayout::itemAt(int pos) const
+{
+    return nodes.at(nodeAt(pos));
+}
+
+int WTableViewLayout::nodeAt(int pos) const
+{
+    Q_ASSERT_X(pos >= 0 && pos < itemCount(),"WTableViewLayout::nodeAt","position is out of range");
+    int t = root;
+    for(;;){
+        const Node &node = nodes.at(t);
+        int leftCount = node.left < 0 ? 0 : nodes.at(node.left).count;
+        if(pos < leftCount){
+            t = node.left;
+        }else if(pos < leftCount + node.repeat){
+            return t;
+        }else {
+            pos -= leftCount + node.repeat;
+            t = node.right;
+        }
+    }
+}
+
+void WTableViewLayout::setItemHeight(int pos, int height)
+{
+    if(itemAt(pos).height == height && !isItemEstimated(pos)) return;
+    int l,m,r;
+    split(root,pos,l,r);
+    split(r,1,m,r);
+    if(nodes.at(m).estimated){
+        estimatedRows --;
+    }
+    nodes[m].height = height;
+    nodes[m].estimated = false;
+    pull(m);
+    root = merge(merge(l,m),r);
+}
+
+// position of the item whose [y,y + height) contains y, zero height items are never hit
+int WTableViewLayout::itemAtY(qint64 y) const
+{
+    if(y < 0 || y >= contentHeight()) return -1;
+    int t = root;
+    int pos = 0;
+    while(t >= 0){
+        const Node &node = nodes.at(t);
+        qint64 leftSum = node.left < 0 ? 0 : nodes.at(node.left).sum;
+        int leftCount = node.left < 0 ? 0 : nodes.at(node.left).count;
+        qint64 runHeight = qint64(node.height) * node.repeat;
+        if(y < leftSum){
+            t = node.left;
+        }else if(y < leftSum + runHeight){
+            return pos + leftCount + int((y - leftSum) / node.height);
+        }else {
+            y -= leftSum + runHeight;
+            pos += leftCount + node.repeat;
+            t = node.right;
+        }
+    }
+    return -1;
+}
+
+int WTableViewLayout::itemCount() const
+{
+    return root < 0 ? 0 : nodes.at(root).count;
+}
+
+// position of the first item ending below y, the item count if there is none
+int WTableViewLayout::itemFromY(qint64 y) const
+{
+    if(y < 0) return 0;
+    if(y >= contentHeight()) return itemCount();
+    return itemAtY(y);
+}
+
+int WTableViewLayout::sectionStart(int section) const
+{
+    int t = sectionRoot;
+    int start = 0;
+    while(t >= 0){
+        const SectionNode &node = sectionNodes.at(t);
+        int leftCount = node.left < 0 ? 0 : sectionNodes.at(node.left).count;
+        if(section <= leftCount){
+            t = node.left;
+        }else {
+            start += (node.left < 0 ? 0 : sectionNodes.at(node.left).sumItems) + node.items;
+            section -= leftCount + 1;
+            t = node.right;
+        }
+    }
+    return start;
+}
+
+int WTableViewLayout::sectionForItem(int pos) const
+{
+    int t = sectionRoot;
+    int section = 0;
+    while(t >= 0){
+        const SectionNode &node = sectionNodes.at(t);
+        int leftItems = node.left < 0 ? 0 : sectionNodes.at(node.left).sumItems;
+        int leftCount = node.left < 0 ? 0 : sectionNodes.at(node.left).count;
+        if(pos < leftItems){
+            t = node.left;
+        }else if(pos < leftItems + node.items){
+            return section + leftCount;
+        }else {
+            pos -= leftItems + node.items;
+            section += leftCount + 1;
+            t = node.right;
+        }
+    }
+    return section;
+}
+
+int WTableViewLayout::sectionItemCount(int section) const
+{
+    return sectionAt(section).items;
+}
+
+const WTableViewLayout::SectionNode &WTableViewLayout::sectionAt(int section) const
+{
+    Q_ASSERT_X(section >= 0 && section < numberOfSections(),"WTableViewLayout::sectionAt","section is out of range");
+    int t = sectionRoot;
+    for(;;){
+        const SectionNode &node = sectionNodes.at(t);
+        int leftCount = node.left < 0 ? 0 : sectionNodes.at(node.left).count;
+        if(section < leftCount){
+            t = node.left;
+        }else if(section == leftCount){
+            return node;
+        }else {
+            section -= leftCount + 1;
+            t = node.right;
+        }
+    }
+}
+
+int WTableViewLayout::nextNonEmptySection(int section) const
+{
+    return firstNonEmptySection(sectionRoot,0,section);
+}
+
+// base is the index of the first section of t. a subtree entirely after from with a non empty section
+// always holds the answer, so at most one path fails besides the one that finds it
+int WTableViewLayout::firstNonEmptySection(int t, int base, int from) const
+{
+    if(t < 0 || sectionNodes.at(t).nonEmpty == 0) return -1;
+    const SectionNode &node = sectionNodes.at(t);
+    int index = base + (node.left < 0 ? 0 : sectionNodes.at(node.left).count);
+    if(from < index){
+        int found = firstNonEmptySection(node.left,base,from);
+        if(found >= 0) return found;
+    }
+    if(from <= index && node.rows > 0) return index;
+    return firstNonEmptySection(node.right,index + 1,from);
+}
+
+void WTableViewLayout::updateSection(int section, int items, int rows)
+{
+    if(items == 0 && rows == 0) return;
+    updateSection(sectionRoot,section,items,rows);
+}
+
+void WTableViewLayout::updateSection(int t, int section, int items, int rows)
+{
+    SectionNode &node = sectionNodes[t];
+    int leftCount = node.left < 0 ? 0 : sectionNodes.at(node.left).count;
+    if(section < leftCount){
+        updateSection(node.left,section,items,rows);
+    }else if(section == leftCount){
+        node.items += items;
+        node.rows += rows;
+    }else {
+        updateSection(node.right,section - leftCount - 1,items,rows);
+    }
+    pullSection(t);
+}
+
+int WTableViewLayout::newSection(int items, int rows)
+{
+    SectionNode node;
+    node.items = items;
+    node.rows = rows;
+    node.left = -1;
+    node.right = -1;
+    node.priority = nextPriority();
+    int t;
+    if(!freeSectionNodes.isEmpty()){
+        t = freeSectionNodes.takeLast();
+        sectionNodes[t] = node;
+    }else {
+        sectionNodes.push_back(node);
+        t = sectionNodes.size() - 1;
+    }
+    pullSection(t);
+    return t;
+}
+
+void WTableViewLayout::pullSection(int t)
+{
+    SectionNode &node = sectionNodes[t];
+    node.sumItems = node.items;
+    node.count = 1;
+    node.nonEmpty = node.rows > 0 ? 1 : 0;
+    if(node.left >= 0){
+        node.sumItems += sectionNodes.at(node.left).sumItems;
+        node.count += sectionNodes.at(node.left).count;
+        node.nonEmpty += sectionNodes.at(node.left).nonEmpty;
+    }
+    if(node.right >= 0){
+        node.sumItems += sectionNodes.at(node.right).sumItems;
+        node.count += sectionNodes.at(node.right).count;
+        node.nonEmpty += sectionNodes.at(node.right).nonEmpty;
+    }
+}
+
+// l receives the first k sections of t, r the rest
+void WTableViewLayout::splitSections(int t, int k, int &l, int &r)
+{
+    if(t < 0){
+        l = r = -1;
+        return;
+    }
+    int left = sectionNodes.at(t).left;
+    int leftCount = left < 0 ? 0 : sectionNodes.at(left).count;
+    if(k <= leftCount){
+        int ll,lr;
+        splitSections(left,k,ll,lr);
+        sectionNodes[t].left = lr;
+        l = ll;
+        r = t;
+    }else {
+        int rl,rr;
+        splitSections(sectionNodes.at(t).right,k - leftCount - 1,rl,rr);
+        sectionNodes[t].right = rl;
+        l = t;
+        r = rr;
+    }
+    pullSection(t);
+}
+
+int WTableViewLayout::mergeSections(int l, int r)
+{
+    if(l < 0) return r;
+    if(r < 0) return l;
+    if(sectionNodes.at(l).priority > sectionNodes.at(r).priority){
+        int right = mergeSections(sectionNodes.at(l).right,r);
+        sectionNodes[l].right = right;
+        pullSection(l);
+        return l;
+    }
+    int left = mergeSections(l,sectionNodes.at(r).left);
+    sectionNodes[r].left = left;
+    pullSection(r);
+    return r;
+}
+
+quint32 WTableViewLayout::nextPriority()
+{
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    return seed;
+}
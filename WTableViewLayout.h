@@ -0,0 +1,149 @@
+//  Created by wangwei
+//  Copyright © 2017-03-25 ExecuteSystem. All rights reserved.
+#ifndef WTABLEVIEWLAYOUT_H
+#define WTABLEVIEWLAYOUT_H
+
+#include <QVector>
+#include "WTableView.h"
+
+// Geometry index of a table view.
+// Every section is stored as one header item followed by its rows, all kept in an
+// implicit treap ordered by position, so height updates, inserts, deletes and Y lookups
+// are O(log N). A second implicit treap holds the item and row counts of the sections in order,
+// it maps index paths to treap positions and keeps section inserts and deletes O(log S).
+// A treap node holds a run of consecutive rows sharing the same height, a section of
+// uniform rows costs two nodes whatever its row count. Runs are split on demand.
+// Row heights can be stored as estimates, they are flagged until setRowHeight stores the real value.
+// Flagging every row of a section is a lazy tag on its subtree, pushed down when the subtree is split.
+// Item heights are int, positions and sums are 64-bit so the content can exceed 2^31 pixels.
+// A row measured from a self-sizing cell keeps the measured heights in its own run, so the cache
+// follows the row through inserts, removals and width changes without any remapping.
+// With more than one column the rows of a section flow into lines of that many rows, the treap
+// stores lines and a row has the position and the height of its line.
+class WTableViewLayout
+{
+public:
+    WTableViewLayout();
+
+    void clear();
+    void setColumns(int columns);// the layout must be empty
+    int getColumns() const;
+    void appendSection(int headerHeight,const QVector<int> &rowHeights,const QVector<bool> &estimated = QVector<bool>());
+    void appendSection(int headerHeight,int rows,int rowHeight,bool estimated = false);
+    void insertSection(int section,int headerHeight,const QVector<int> &rowHeights,const QVector<bool> &estimated = QVector<bool>());
+    void insertSection(int section,int headerHeight,int rows,int rowHeight,bool estimated = false);
+    void removeSection(int section);
+    void insertRow(const WIndexPath &indexPath,int height,bool estimated = false);
+    void insertRows(const WIndexPath &indexPath,const QVector<int> &heights,const QVector<bool> &estimated = QVector<bool>());
+    void insertRows(const WIndexPath &indexPath,int rows,int height,bool estimated = false);
+    void removeRow(const WIndexPath &indexPath);
+    void removeRows(const WIndexPath &indexPath,int rows);
+    void moveRows(const WIndexPath &fromIndexPath,int rows,const WIndexPath &toIndexPath);// toIndexPath is counted without the moved rows
+    void setRowHeight(const WIndexPath &indexPath,int height);
+    void setHeaderHeight(int section,int height);
+    void setRowHeights(int section,int height);// every line of section, stored as one run
+    void invalidateRowHeights(int section);// current heights of the rows of section become estimates, O(log N)
+    int cachedRowHeight(const WIndexPath &indexPath,quint64 version,int width) const;// -1 if the height is not cached
+    void cacheRowHeight(const WIndexPath &indexPath,quint64 version,int width,int height);// the row becomes a run of its own
+    void removeCachedRowHeight(const WIndexPath &indexPath);
+
+    int numberOfSections() const;
+    int numberOfRowsInSection(int section) const;
+    bool contains(const WIndexPath &indexPath) const;
+    qint64 contentHeight() const;
+    qint64 rowY(const WIndexPath &indexPath) const;
+    int rowHeight(const WIndexPath &indexPath) const;
+    bool isRowHeightEstimated(const WIndexPath &indexPath) const;
+    int estimatedRowCount() const;
+    WIndexPath firstEstimatedRow() const;// invalid if every row is measured
+    qint64 headerY(int section) const;
+    int headerHeight(int section) const;
+    qint64 sectionHeight(int section) const;// header and all rows
+    WIndexPath indexPathForRowAtY(qint64 y) const;// returns a invalid indexPath if y is on a header or outside of the content
+    int sectionAtY(qint64 y) const;// returns -1 if y is outside of the content
+    WIndexPath firstRowFromY(qint64 y) const;// first row ending below y, invalid if there is none
+    int firstSectionFromY(qint64 y) const;// first section ending below y, numberOfSections() if there is none
+    WIndexPath nextIndexPath(const WIndexPath &indexPath) const;// skips empty sections, invalid after the last row
+
+private:
+    struct Node{
+        int height;// of every item in the run
+        int repeat;
+        qint64 sum;
+        int count;
+        int estimatedCount;// estimated items in the subtree
+        int left;
+        int right;
+        int measure;// index in measures for a run of one row, -1 if the row has no cached height
+        quint32 priority : 30;
+        quint32 estimated : 1;
+        quint32 lazyEstimated : 1;// the items of the subtrees are estimated, not pushed to the children yet
+    };
+    QVector<Node> nodes;
+    QVector<int> freeNodes;
+    int root;
+    struct Measure{
+        quint64 version;
+        int widths[2];// most recent first, the heights of the two last widths are kept
+        int heights[2];
+    };
+    QVector<Measure> measures;
+    QVector<int> freeMeasures;
+    struct SectionNode{
+        int items;// header and lines
+        int rows;
+        int sumItems;
+        int count;// sections in the subtree
+        int nonEmpty;// sections with rows in the subtree
+        int left;
+        int right;
+        quint32 priority;
+    };
+    QVector<SectionNode> sectionNodes;
+    QVector<int> freeSectionNodes;
+    int sectionRoot;
+    int columns;
+    int estimatedRows;
+    quint32 seed;
+
+    int newNode(int height,int repeat = 1,bool estimated = false);
+    void releaseTree(int t);
+    void markEstimated(int t);
+    void push(int t);
+    bool isItemEstimated(int pos) const;
+    int buildTree(int headerHeight,const QVector<int> &rowHeights,const QVector<bool> &estimated);
+    int buildTree(int headerHeight,int rows,int rowHeight,bool estimated);
+    int buildRuns(const QVector<int> &heights,const QVector<bool> &estimated);
+    void insertTree(const WIndexPath &indexPath,int tree,int rows);
+    void appendSectionTree(int tree,int items,int rows);
+    void insertSectionTree(int section,int tree,int items,int rows);
+    int linesForRows(int rows) const;
+    void toLines(const QVector<int> &rowHeights,const QVector<bool> &estimated,QVector<int> &lineHeights,QVector<bool> &lineEstimated) const;
+    void resizeSectionLines(int section,int rows,int height,bool estimated);
+    int itemForRow(const WIndexPath &indexPath) const;
+    void pull(int t);
+    void split(int t,int k,int &l,int &r);
+    int merge(int l,int r);
+    qint64 prefixHeight(int pos) const;
+    const Node &itemAt(int pos) const;
+    int nodeAt(int pos) const;
+    void setItemHeight(int pos,int height);
+    int itemCount() const;
+    int itemAtY(qint64 y) const;
+    int itemFromY(qint64 y) const;
+    int sectionStart(int section) const;
+    int sectionForItem(int pos) const;
+    int sectionItemCount(int section) const;
+    const SectionNode &sectionAt(int section) const;
+    int nextNonEmptySection(int section) const;// first section from section with rows, -1 if there is none
+    int firstNonEmptySection(int t,int base,int from) const;
+    void updateSection(int section,int items,int rows);// adds items and rows to the counts of section
+    void updateSection(int t,int section,int items,int rows);
+    int newSection(int items,int rows);
+    void pullSection(int t);
+    void splitSections(int t,int k,int &l,int &r);
+    int mergeSections(int l,int r);
+    quint32 nextPriority();
+};
+
+#endif // WTABLEVIEWLAYOUT_H
@@ -0,0 +1,267 @@
+//  Created by wangwei
+//  Copyright © 2017-03-25 ExecuteSystem. All rights reserved.
+#include <QTimer>
+#include "WTableViewModelAdapter.h"
+
+// a layout change with more selected rows reloads the table, tracking them costs a persistent index each
+static const int LayoutTrackingLimit = 1000;
+
+WTableViewModelAdapter::WTableViewModelAdapter(WTableView *tableView, QObject *parent) :
+    QObject(parent),
+    tableView(tableView),
+    column(0),
+    defaultRowHeight(44),
+    batching(false),
+    reloading(false),
+    batchTimer(new QTimer(this)),
+    trackingLayout(false),
+    layoutTooLarge(false)
+{
+    Q_ASSERT_X(tableView,"WTableViewModelAdapter","tableView is null");
+    batchTimer->setSingleShot(true);
+    batchTimer->setInterval(0);
+    connect(batchTimer,&QTimer::timeout,this,&WTableViewModelAdapter::finishBatch);
+}
+
+WTableViewModelAdapter::~WTableViewModelAdapter()
+{
+    finishBatch();
+    if(tableView && tableView->getDelegate() == this){
+        tableView->setDelegate(nullptr);
+    }
+}
+
+QAbstractItemModel *WTableViewModelAdapter::getModel()
+{
+    return model;
+}
+
+void WTableViewModelAdapter::setModel(QAbstractItemModel *model)
+{
+    if(this->model == model) return;
+    finishBatch();
+    if(this->model){
+        disconnect(this->model.data(),nullptr,this,nullptr);
+    }
+    this->model = model;
+    rootIndex = QModelIndex();
+    if(model){
+        // the about to signals open the batch while the table still matches the model
+        connect(model,&QAbstractItemModel::rowsAboutToBeInserted,this,&WTableViewModelAdapter::beginBatch);
+        connect(model,&QAbstractItemModel::rowsAboutToBeRemoved,this,&WTableViewModelAdapter::beginBatch);
+        connect(model,&QAbstractItemModel::rowsAboutToBeMoved,this,&WTableViewModelAdapter::beginBatch);
+        connect(model,&QAbstractItemModel::modelAboutToBeReset,this,&WTableViewModelAdapter::beginBatch);
+        connect(model,&QAbstractItemModel::layoutAboutToBeChanged,this,&WTableViewModelAdapter::onLayoutAboutToBeChanged);
+        connect(model,&QAbstractItemModel::rowsInserted,this,&WTableViewModelAdapter::onRowsInserted);
+        connect(model,&QAbstractItemModel::rowsRemoved,this,&WTableViewModelAdapter::onRowsRemoved);
+        connect(model,&QAbstractItemModel::rowsMoved,this,&WTableViewModelAdapter::onRowsMoved);
+        connect(model,&QAbstractItemModel::dataChanged,this,&WTableViewModelAdapter::onDataChanged);
+        connect(model,&QAbstractItemModel::layoutChanged,this,&WTableViewModelAdapter::onLayoutChanged);
+        connect(model,&QAbstractItemModel::modelReset,this,&WTableViewModelAdapter::onModelReset);
+        connect(model,&QObject::destroyed,this,[this]{
+            finishBatch();
+            if(tableView){
+                tableView->reloadData();
+            }
+        });
+    }
+    if(tableView->getDelegate() != this){
+        tableView->setDelegate(this);
+    }
+    tableView->reloadData();
+}
+
+QModelIndex WTableViewModelAdapter::getRootIndex()
+{
+    return rootIndex;
+}
+
+void WTableViewModelAdapter::setRootIndex(const QModelIndex &index)
+{
+    if(rootIndex == index) return;
+    finishBatch();
+    rootIndex = index;
+    tableView->reloadData();
+}
+
+int WTableViewModelAdapter::getColumn()
+{
+    return column;
+}
+
+void WTableViewModelAdapter::setColumn(int column)
+{
+    if(this->column == column) return;
+    this->column = column;
+    tableView->reloadData();
+}
+
+int WTableViewModelAdapter::getDefaultRowHeight()
+{
+    return defaultRowHeight;
+}
+
+void WTableViewModelAdapter::setDefaultRowHeight(int height)
+{
+    if(defaultRowHeight == height) return;
+    defaultRowHeight = height;
+    tableView->reloadData();
+}
+
+QModelIndex WTableViewModelAdapter::modelIndexForIndexPath(const WIndexPath &indexPath)
+{
+    if(!model || indexPath.section != 0 || indexPath.row < 0) return QModelIndex();
+    return model->index(indexPath.row,column,rootIndex);
+}
+
+WIndexPath WTableViewModelAdapter::indexPathForModelIndex(const QModelIndex &index)
+{
+    if(!model || !index.isValid() || index.model() != model || !isRoot(index.parent())) return WIndexPath(-1,-1);
+    return WIndexPath(0,index.row());
+}
+
+int WTableViewModelAdapter::numberOfSectionsInTableView(WTableView *)
+{
+    return model ? 1 : 0;
+}
+
+int WTableViewModelAdapter::tableViewNumberOfRowsInSection(WTableView *, int section)
+{
+    if(!model || section != 0) return 0;
+    return model->rowCount(rootIndex);
+}
+
+int WTableViewModelAdapter::tableViewHeightForRowAtIndexPath(WTableView *, const WIndexPath &indexPath)
+{
+    QSize size = modelIndexForIndexPath(indexPath).data(Qt::SizeHintRole).toSize();
+    return size.height() > 0 ? size.height() : defaultRowHeight;
+}
+
+// the table applies every change of the batch to its layout index only, finishBatch renders once
+void WTableViewModelAdapter::beginBatch()
+{
+    if(batching || !tableView) return;
+    batching = true;
+    tableView->beginUpdates();
+    batchTimer->start();
+}
+
+void WTableViewModelAdapter::finishBatch()
+{
+    batchTimer->stop();
+    if(!batching) return;
+    batching = false;
+    reloading = false;
+    if(tableView){
+        tableView->endUpdates();
+    }
+}
+
+void WTableViewModelAdapter::onRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if(reloading || !tableView || !isRoot(parent)) return;
+    int count = last - first + 1;
+    if(last + 1 == model->rowCount(rootIndex)){
+        // a table scrolled to the bottom follows the appended rows
+        tableView->appendRows(0,count);
+    }else {
+        tableView->insertRowsAtIndexPath(WIndexPath(0,first),count);
+    }
+}
+
+void WTableViewModelAdapter::onRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if(reloading || !tableView || !isRoot(parent)) return;
+    tableView->deleteRowsAtIndexPath(WIndexPath(0,first),last - first + 1);
+}
+
+// row is the destination before the rows are taken out, as in QAbstractItemModel::beginMoveRows
+void WTableViewModelAdapter::onRowsMoved(const QModelIndex &parent, int start, int end, const QModelIndex &destination, int row)
+{
+    if(reloading || !tableView) return;
+    bool fromRoot = isRoot(parent);
+    bool toRoot = isRoot(destination);
+    int count = end - start + 1;
+    if(fromRoot && toRoot){
+        // the table counts the destination once the block is taken out
+        if(row > end + 1){
+            tableView->moveRowsAtIndexPath(WIndexPath(0,start),count,WIndexPath(0,row - count));
+        }else if(row < start){
+            tableView->moveRowsAtIndexPath(WIndexPath(0,start),count,WIndexPath(0,row));
+        }
+    }else if(fromRoot){
+        tableView->deleteRowsAtIndexPath(WIndexPath(0,start),count);
+    }else if(toRoot){
+        tableView->insertRowsAtIndexPath(WIndexPath(0,row),count);
+    }
+}
+
+void WTableViewModelAdapter::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    if(!tableView || !isRoot(topLeft.parent())) return;
+    beginBatch();
+    if(reloading) return;
+    for(int row = topLeft.row(); row <= bottomRight.row(); row ++){
+        tableView->reloadRowAtIndexPath(WIndexPath(0,row));
+    }
+}
+
+// only the selected rows are tracked through persistent indexes, the content is refreshed in bulk
+void WTableViewModelAdapter::onLayoutAboutToBeChanged(const QList<QPersistentModelIndex> &parents)
+{
+    beginBatch();
+    if(reloading || !tableView) return;
+    if(!parents.isEmpty() && !parents.contains(rootIndex)) return;
+    trackingLayout = true;
+    layoutSelectedRows.clear();
+    if(tableView->numberOfSelectedRows() > LayoutTrackingLimit){
+        layoutTooLarge = true;
+        return;
+    }
+    layoutTooLarge = false;
+    for(const WIndexPath &indexPath:tableView->indexPathsForSelectedRows()){
+        layoutSelectedRows.push_back(model->index(indexPath.row,column,rootIndex));
+    }
+}
+
+void WTableViewModelAdapter::onLayoutChanged(const QList<QPersistentModelIndex> &)
+{
+    if(!trackingLayout) return;
+    trackingLayout = false;
+    QVector<QPersistentModelIndex> selected;
+    selected.swap(layoutSelectedRows);
+    if(reloading || !tableView) return;
+    if(layoutTooLarge){
+        reload();
+        return;
+    }
+    // heights and cells of every row are requested again, the selection follows its rows
+    tableView->refreshContent();
+    tableView->clearSelection();
+    for(const QPersistentModelIndex &index:selected){
+        if(index.isValid() && isRoot(index.parent())){
+            tableView->selectedRowAtIndexPath(WIndexPath(0,index.row()));
+        }
+    }
+}
+
+void WTableViewModelAdapter::onModelReset()
+{
+    if(!tableView) return;
+    beginBatch();
+    reload();
+}
+
+// the incremental signals left in the batch are already part of the reloaded content
+void WTableViewModelAdapter::reload()
+{
+    if(batching){
+        reloading = true;
+    }
+    tableView->reloadData();
+}
+
+bool WTableViewModelAdapter::isRoot(const QModelIndex &parent)
+{
+    return rootIndex == parent;
+}
@@ -0,0 +1,72 @@
+//  Created by wangwei
+//  Copyright © 2017-03-25 ExecuteSystem. All rights reserved.
+#ifndef WTABLEVIEWMODELADAPTER_H
+#define WTABLEVIEWMODELADAPTER_H
+
+#include <QObject>
+#include <QPointer>
+#include <QAbstractItemModel>
+#include <QPersistentModelIndex>
+#include "WTableViewDelegate.h"
+
+class QTimer;
+
+// Delegate backed by a QAbstractItemModel, the rows of the root index are the rows of section 0.
+// Model signals are mapped to the incremental operations of the table view: inserts, removes and
+// moves shift the layout index in O(log N), changed rows are reloaded one by one and a layout change
+// refreshes the content in bulk while the selection follows its rows. The signals of one event loop
+// pass are applied between beginUpdates and endUpdates, so a burst of changes costs one render.
+// A model reset reloads.
+// Subclasses provide the cells, modelIndexForIndexPath gives the index of a row. Row heights come
+// from Qt::SizeHintRole unless the table view has a uniform row height.
+class WTableViewModelAdapter : public QObject, public WTableViewDelegate
+{
+    Q_OBJECT
+public:
+    explicit WTableViewModelAdapter(WTableView *tableView,QObject *parent = 0);
+    virtual ~WTableViewModelAdapter();
+
+    QAbstractItemModel *getModel();
+    void setModel(QAbstractItemModel *model);// becomes the delegate of the table view
+    QModelIndex getRootIndex();
+    void setRootIndex(const QModelIndex &index);
+    int getColumn();
+    void setColumn(int column);// column of the indexes returned by modelIndexForIndexPath
+    int getDefaultRowHeight();
+    void setDefaultRowHeight(int height);// rows without a Qt::SizeHintRole height
+    QModelIndex modelIndexForIndexPath(const WIndexPath &indexPath);
+    WIndexPath indexPathForModelIndex(const QModelIndex &index);// invalid if index is not a row of the root index
+
+    int numberOfSectionsInTableView(WTableView *tableView) Q_DECL_OVERRIDE;
+    int tableViewNumberOfRowsInSection(WTableView *tableView,int section) Q_DECL_OVERRIDE;
+    int tableViewHeightForRowAtIndexPath(WTableView *tableView,const WIndexPath &indexPath) Q_DECL_OVERRIDE;
+
+private slots:
+    void beginBatch();
+    void onRowsInserted(const QModelIndex &parent,int first,int last);
+    void onRowsRemoved(const QModelIndex &parent,int first,int last);
+    void onRowsMoved(const QModelIndex &parent,int start,int end,const QModelIndex &destination,int row);
+    void onDataChanged(const QModelIndex &topLeft,const QModelIndex &bottomRight);
+    void onLayoutAboutToBeChanged(const QList<QPersistentModelIndex> &parents);
+    void onLayoutChanged(const QList<QPersistentModelIndex> &parents);
+    void onModelReset();
+    void finishBatch();
+
+private:
+    QPointer<WTableView> tableView;
+    QPointer<QAbstractItemModel> model;
+    QPersistentModelIndex rootIndex;
+    int column;
+    int defaultRowHeight;
+    bool batching;
+    bool reloading;// a full reload is pending for the batch, incremental signals are ignored until it runs
+    QTimer *batchTimer;
+    bool trackingLayout;
+    bool layoutTooLarge;// the selection is not tracked, the layout change reloads
+    QVector<QPersistentModelIndex> layoutSelectedRows;
+
+    void reload();
+    bool isRoot(const QModelIndex &parent);
+};
+
+#endif // WTABLEVIEWMODELADAPTER_H
@@ -0,0 +1,112 @@
+//  Created by wangwei
+//  Copyright © 2017-03-25 ExecuteSystem. All rights reserved.
+#ifndef WTABLEVIEWREUSEPOOL_H
+#define WTABLEVIEWREUSEPOOL_H
+
+#include <QHash>
+#include <QVector>
+#include <QString>
+
+// Reuse queues of WTableViewCell or WTableViewHeader.
+// Identifiers are interned to an int key the first time a view is registered, every view
+// remembers its key and its slot in the idle list of that key, so dequeue, recycle and
+// claiming a view back are O(1) whatever the size of the pool.
+template<typename T>
+class WTableViewReusePool
+{
+public:
+    WTableViewReusePool() : total(0),idle(0) {}
+
+    T *dequeue(const QString &identifier)
+    {
+        int key = keys.value(identifier,-1);
+        if(key < 0) return nullptr;
+        QVector<T *> &views = queues[key];
+        if(views.isEmpty()) return nullptr;
+        T *view = views.takeLast();
+        view->reuseIndex = -1;
+        idle --;
+        return view;
+    }
+
+    // registers a view created by the delegate, or takes an idle one out of its queue.
+    // returns true if the view was new to the pool
+    bool claim(T *view)
+    {
+        if(view->reuseKey < 0){
+            view->reuseKey = keyForIdentifier(view->identifier);
+            view->reuseIndex = -1;
+            total ++;
+            return true;
+        }
+        if(view->reuseIndex < 0) return false;
+        QVector<T *> &views = queues[view->reuseKey];
+        T *last = views.takeLast();
+        if(last != view){
+            views[view->reuseIndex] = last;
+            last->reuseIndex = view->reuseIndex;
+        }
+        view->reuseIndex = -1;
+        idle --;
+        return false;
+    }
+
+    void recycle(T *view)
+    {
+        if(view->reuseKey < 0){
+            claim(view);
+        }
+        if(view->reuseIndex >= 0) return;
+        QVector<T *> &views = queues[view->reuseKey];
+        view->reuseIndex = views.size();
+        views.push_back(view);
+        idle ++;
+    }
+
+    QVector<T *> idleViews() const
+    {
+        QVector<T *> views;
+        views.reserve(idle);
+        for(const QVector<T *> &queue:queues){
+            views += queue;
+        }
+        return views;
+    }
+
+    // forgets every view, the caller owns the views it still references
+    void clear()
+    {
+        for(const QVector<T *> &queue:queues){
+            for(T *view:queue){
+                view->reuseKey = -1;
+                view->reuseIndex = -1;
+            }
+        }
+        keys.clear();
+        queues.clear();
+        total = 0;
+        idle = 0;
+    }
+
+    int size() const {return total;}
+    int idleSize() const {return idle;}
+
+private:
+    QHash<QString,int> keys;
+    QVector<QVector<T *> > queues;
+    int total;
+    int idle;
+
+    int keyForIdentifier(const QString &identifier)
+    {
+        int key = keys.value(identifier,-1);
+        if(key < 0){
+            key = queues.size();
+            keys.insert(identifier,key);
+            queues.push_back(QVector<T *>());
+        }
+        return key;
+    }
+};
+
+#endif // WTABLEVIEWREUSEPOOL_H
@@ -0,0 +1,93 @@
+//  Created by wangwei
+//  Copyright © 2017-03-25 ExecuteSystem. All rights reserved.
+#ifndef WTABLEVIEWRINGBUFFER_H
+#define WTABLEVIEWRINGBUFFER_H
+
+#include <QVector>
+
+// Bounded row storage for a delegate streaming rows into a table view.
+// Rows are appended at the tail in amortized O(1), once the capacity is reached every append
+// drops the oldest row, so the memory stays bounded however long the stream runs. Row i is the
+// i-th oldest row, which is the row index the table view sees after WTableView::appendRows.
+// The rows dropped by a batch of appends are passed along with them:
+//     int dropped = 0;
+//     for(const T &row:rows) dropped += buffer.append(row);
+//     tableView->appendRows(section,rows.size(),dropped);
+// The capacity must be positive. T must be default constructible, the storage doubles up to the capacity.
+template<typename T>
+class WTableViewRingBuffer
+{
+public:
+    explicit WTableViewRingBuffer(int capacity) : cap(capacity),head(0),count(0)
+    {
+        Q_ASSERT_X(capacity > 0,"WTableViewRingBuffer","capacity must be positive");
+    }
+
+    // returns the number of rows dropped from the head to make room, 0 or 1
+    int append(const T &value)
+    {
+        if(count < cap){
+            if(count == items.size()){
+                // the storage doubles up to the capacity, the rows are unrolled from the oldest one
+                QVector<T> grown(qMin(qMax(count * 2,1),cap));
+                for(int i = 0; i < count; i ++){
+                    grown[i] = at(i);
+                }
+                items.swap(grown);
+                head = 0;
+            }
+            items[(head + count) % items.size()] = value;
+            count ++;
+            return 0;
+        }
+        items[head] = value;
+        head = (head + 1) % items.size();
+        return 1;
+    }
+
+    void removeFirst(int n)
+    {
+        n = qBound(0,n,count);
+        if(n == 0) return;
+        head = (head + n) % items.size();
+        count -= n;
+    }
+
+    const T &at(int i) const {return items.at((head + i) % items.size());}
+    T &operator[](int i) {return items[(head + i) % items.size()];}
+    int size() const {return count;}
+    bool isEmpty() const {return count == 0;}
+    int capacity() const {return cap;}
+
+    // keeps the newest rows, returns the number of rows dropped from the head
+    int setCapacity(int capacity)
+    {
+        Q_ASSERT_X(capacity > 0,"setCapacity","capacity must be positive");
+        int dropped = qMax(count - capacity,0);
+        QVector<T> kept;
+        kept.reserve(count - dropped);
+        for(int i = dropped; i < count; i ++){
+            kept.push_back(at(i));
+        }
+        items = kept;
+        cap = capacity;
+        head = 0;
+        count = kept.size();
+        return dropped;
+    }
+
+    void clear()
+    {
+        items.clear();
+        head = 0;
+        count = 0;
+    }
+
+private:
+    QVector<T> items;
+    int cap;
+    int head;// slot of the oldest row
+    int count;
+};
+
+#endif // WTABLEVIEWRINGBUFFER_H
@@ -0,0 +1,280 @@
+//  Created by wangwei
+//  Copyright © 2017-03-25 ExecuteSystem. All rights reserved.
+#include "WTableViewRowCache.h"
+
+WTableViewRowCache::WTableViewRowCache() :
+    head(-1),
+    tail(-1),
+    budget(0),
+    used(0)
+{
+}
+
+WTableViewRowCache::~WTableViewRowCache()
+{
+    qDeleteAll(sections);
+}
+
+void WTableViewRowCache::setBudget(qint64 bytes)
+{
+    budget = qMax<qint64>(bytes,0);
+    evict();
+}
+
+qint64 WTableViewRowCache::getBudget() const
+{
+    return budget;
+}
+
+qint64 WTableViewRowCache::bytes() const
+{
+    return used;
+}
+
+int WTableViewRowCache::count() const
+{
+    return entries.size() - freeEntries.size();
+}
+
+const QPixmap *WTableViewRowCache::find(const WIndexPath &indexPath, quint64 version, bool selected, const QSize &size)
+{
+    Section *s = sectionAt(indexPath.section);
+    int e = s ? s->rows.value(indexPath.row + s->base,-1) : -1;
+    if(e < 0) return nullptr;
+    const Entry &entry = entries.at(e);
+    if(entry.version != version || entry.selected != selected || entry.size != size){
+        release(e);
+        return nullptr;
+    }
+    if(e != head){
+        unlink(e);
+        link(e);
+    }
+    return &entries.at(e).pixmap;
+}
+
+const QPixmap *WTableViewRowCache::insert(const WIndexPath &indexPath, quint64 version, bool selected, const QSize &size, const QPixmap &pixmap)
+{
+    remove(indexPath);
+    qint64 bytes = qint64(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+    if(bytes > budget) return nullptr;
+    int e;
+    if(!freeEntries.isEmpty()){
+        e = freeEntries.takeLast();
+    }else {
+        e = entries.size();
+        entries.push_back(Entry());
+    }
+    if(indexPath.section >= sections.size()){
+        sections.resize(indexPath.section + 1);
+    }
+    Section *&s = sections[indexPath.section];
+    if(!s){
+        s = new Section();
+        s->base = 0;
+    }
+    Entry &entry = entries[e];
+    entry.section = s;
+    entry.key = indexPath.row + s->base;
+    entry.version = version;
+    entry.selected = selected;
+    entry.size = size;
+    entry.pixmap = pixmap;
+    entry.bytes = bytes;
+    link(e);
+    s->rows.insert(entry.key,e);
+    used += bytes;
+    evict();
+    return &entries.at(e).pixmap;
+}
+
+void WTableViewRowCache::remove(const WIndexPath &indexPath)
+{
+    Section *s = sectionAt(indexPath.section);
+    int e = s ? s->rows.value(indexPath.row + s->base,-1) : -1;
+    if(e >= 0){
+        release(e);
+    }
+}
+
+void WTableViewRowCache::clear()
+{
+    entries.clear();
+    freeEntries.clear();
+    qDeleteAll(sections);
+    sections.clear();
+    head = -1;
+    tail = -1;
+    used = 0;
+}
+
+void WTableViewRowCache::insertSection(int section)
+{
+    if(section < sections.size()){
+        sections.insert(section,nullptr);
+    }
+}
+
+void WTableViewRowCache::removeSection(int section)
+{
+    Section *s = sectionAt(section);
+    if(s){
+        for(int e:s->rows){
+            discard(e);
+        }
+        delete s;
+    }
+    if(section < sections.size()){
+        sections.remove(section);
+    }
+}
+
+void WTableViewRowCache::insertRows(int section, int row, int count)
+{
+    Section *s = sectionAt(section);
+    if(s && count > 0){
+        shiftRows(s,row,count);
+    }
+}
+
+void WTableViewRowCache::removeRows(int section, int row, int count)
+{
+    Section *s = sectionAt(section);
+    if(!s || count <= 0) return;
+    QMap<qint64,int>::iterator it = s->rows.lowerBound(row + s->base);
+    while(it != s->rows.end() && it.key() < row + count + s->base){
+        discard(it.value());
+        it = s->rows.erase(it);
+    }
+    shiftRows(s,row + count,-count);
+}
+
+void WTableViewRowCache::moveRows(const WIndexPath &fromIndexPath, int count, const WIndexPath &toIndexPath)
+{
+    if(count <= 0) return;
+    // the moved rows are taken out by their offset in the block, they keep their entries
+    QVector<QPair<int,int> > moved;
+    Section *from = sectionAt(fromIndexPath.section);
+    if(from){
+        QMap<qint64,int>::iterator it = from->rows.lowerBound(fromIndexPath.row + from->base);
+        while(it != from->rows.end() && it.key() < fromIndexPath.row + count + from->base){
+            moved.push_back(qMakePair(int(it.key() - from->base - fromIndexPath.row),it.value()));
+            it = from->rows.erase(it);
+        }
+        shiftRows(from,fromIndexPath.row + count,-count);
+    }
+    Section *to = sectionAt(toIndexPath.section);
+    if(to){
+        shiftRows(to,toIndexPath.row,count);
+    }
+    if(moved.isEmpty()) return;
+    if(!to){
+        if(toIndexPath.section >= sections.size()){
+            sections.resize(toIndexPath.section + 1);
+        }
+        to = new Section();
+        to->base = 0;
+        sections[toIndexPath.section] = to;
+    }
+    for(const QPair<int,int> &row:moved){
+        Entry &entry = entries[row.second];
+        entry.section = to;
+        entry.key = toIndexPath.row + row.first + to->base;
+        to->rows.insert(entry.key,row.second);
+    }
+}
+
+void WTableViewRowCache::link(int e)
+{
+    Entry &entry = entries[e];
+    entry.prev = -1;
+    entry.next = head;
+    if(head >= 0){
+        entries[head].prev = e;
+    }else {
+        tail = e;
+    }
+    head = e;
+}
+
+void WTableViewRowCache::unlink(int e)
+{
+    Entry &entry = entries[e];
+    if(entry.prev >= 0){
+        entries[entry.prev].next = entry.next;
+    }else {
+        head = entry.next;
+    }
+    if(entry.next >= 0){
+        entries[entry.next].prev = entry.prev;
+    }else {
+        tail = entry.prev;
+    }
+}
+
+void WTableViewRowCache::release(int e)
+{
+    entries.at(e).section->rows.remove(entries.at(e).key);
+    discard(e);
+}
+
+// frees the entry, the caller takes it out of its section
+void WTableViewRowCache::discard(int e)
+{
+    unlink(e);
+    used -= entries.at(e).bytes;
+    entries[e].section = nullptr;
+    entries[e].pixmap = QPixmap();
+    freeEntries.push_back(e);
+}
+
+void WTableViewRowCache::evict()
+{
+    while(used > budget && tail >= 0){
+        release(tail);
+    }
+}
+
+WTableViewRowCache::Section *WTableViewRowCache::sectionAt(int section) const
+{
+    return section >= 0 && section < sections.size() ? sections.at(section) : nullptr;
+}
+
+// moves the rows from row on by delta, the rows in between must not be cached.
+// the side of the split with fewer entries is re-keyed, a shift of the rows after the split can
+// be a shift of the base and the rows before it instead
+void WTableViewRowCache::shiftRows(Section *s, int row, int delta)
+{
+    if(s->rows.isEmpty()){
+        s->base = 0;
+        return;
+    }
+    QMap<qint64,int>::iterator split = s->rows.lowerBound(row + s->base);
+    QMap<qint64,int>::iterator first = s->rows.begin();
+    QMap<qint64,int>::iterator last = s->rows.end();
+    // both sides are walked at the same pace until one of them ends, O(smaller side)
+    while(last != split && first != split){
+        ++first;
+        --last;
+    }
+    bool shiftTail = last == split;
+    QVector<QPair<qint64,int> > shifted;
+    if(shiftTail){
+        QMap<qint64,int>::iterator it = split;
+        while(it != s->rows.end()){
+            shifted.push_back(qMakePair(it.key() + delta,it.value()));
+            it = s->rows.erase(it);
+        }
+    }else {
+        QMap<qint64,int>::iterator it = s->rows.begin();
+        while(it != split){
+            shifted.push_back(qMakePair(it.key() - delta,it.value()));
+            it = s->rows.erase(it);
+        }
+        s->base -= delta;
+    }
+    for(const QPair<qint64,int> &entry:shifted){
+        entries[entry.second].key = entry.first;
+        s->rows.insert(entry.first,entry.second);
+    }
+}
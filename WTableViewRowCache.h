@@ -0,0 +1,75 @@
+//  Created by wangwei
+//  Copyright © 2017-03-25 ExecuteSystem. All rights reserved.
+#ifndef WTABLEVIEWROWCACHE_H
+#define WTABLEVIEWROWCACHE_H
+
+#include <QMap>
+#include <QVector>
+#include <QPixmap>
+#include "WTableView.h"
+
+// Rendered rows of a WTableView in painted mode.
+// An entry is keyed by index path and only hits for the same content version, selection state
+// and size, so a row is repainted by the delegate only when it changed. Entries are kept in a
+// doubly linked LRU list, the least recently painted rows are evicted once the pixmaps exceed
+// the byte budget.
+// Every section keeps its entries ordered by row, offset by a base. Row and section edits shift
+// the entries in place: only the smaller side of the edited row moves, and rows dropped from the
+// head of a section just move the base.
+class WTableViewRowCache
+{
+public:
+    WTableViewRowCache();
+    ~WTableViewRowCache();
+
+    void setBudget(qint64 bytes);// 0 disables the cache
+    qint64 getBudget() const;
+    qint64 bytes() const;
+    int count() const;
+    const QPixmap *find(const WIndexPath &indexPath,quint64 version,bool selected,const QSize &size);
+    // returns nullptr if the pixmap alone exceeds the budget
+    const QPixmap *insert(const WIndexPath &indexPath,quint64 version,bool selected,const QSize &size,const QPixmap &pixmap);
+    void remove(const WIndexPath &indexPath);
+    void clear();
+
+    // the rows follow the edits of the table view, the removed rows are dropped
+    void insertSection(int section);
+    void removeSection(int section);
+    void insertRows(int section,int row,int count);
+    void removeRows(int section,int row,int count);
+    void moveRows(const WIndexPath &fromIndexPath,int count,const WIndexPath &toIndexPath);// toIndexPath is counted without the moved rows
+
+private:
+    struct Section{
+        QMap<qint64,int> rows;// row + base -> entry
+        qint64 base;
+    };
+    struct Entry{
+        Section *section;
+        qint64 key;
+        quint64 version;
+        bool selected;
+        QSize size;
+        QPixmap pixmap;
+        qint64 bytes;
+        int prev;
+        int next;
+    };
+    QVector<Entry> entries;
+    QVector<int> freeEntries;
+    QVector<Section *> sections;// null until a row of the section is cached
+    int head;// most recently used
+    int tail;
+    qint64 budget;
+    qint64 used;
+
+    void link(int e);
+    void unlink(int e);
+    void release(int e);
+    void discard(int e);
+    void evict();
+    Section *sectionAt(int section) const;
+    void shiftRows(Section *s,int row,int delta);
+};
+
+#endif // WTABLEVIEWROWCACHE_H
@@ -0,0 +1,229 @@
+//  Created by wangwei
+//  Copyright © 2017-03-25 ExecuteSystem. All rights reserved.
+#include "WTableViewSelection.h"
+
+WTableViewSelection::WTableViewSelection()
+{
+}
+
+bool WTableViewSelection::contains(const WIndexPath &indexPath) const
+{
+    QMap<int,QVector<Range> >::const_iterator it = sections.constFind(indexPath.section);
+    if(it == sections.constEnd()) return false;
+    const QVector<Range> &ranges = it.value();
+    int i = firstRangeEndingFrom(ranges,indexPath.row);
+    return i < ranges.size() && ranges.at(i).first <= indexPath.row;
+}
+
+bool WTableViewSelection::isEmpty() const
+{
+    return sections.isEmpty();
+}
+
+qint64 WTableViewSelection::count() const
+{
+    qint64 rows = 0;
+    for(const QVector<Range> &ranges:sections){
+        for(const Range &range:ranges){
+            rows += range.last - range.first + 1;
+        }
+    }
+    return rows;
+}
+
+QVector<WIndexPath> WTableViewSelection::indexPaths() const
+{
+    QVector<WIndexPath> indexPaths;
+    for(QMap<int,QVector<Range> >::const_iterator it = sections.constBegin(); it != sections.constEnd(); ++it){
+        for(const Range &range:it.value()){
+            for(int row = range.first; row <= range.last; row ++){
+                indexPaths.push_back(WIndexPath(it.key(),row));
+            }
+        }
+    }
+    return indexPaths;
+}
+
+void WTableViewSelection::clear()
+{
+    sections.clear();
+}
+
+void WTableViewSelection::selectRows(int section, int first, int last)
+{
+    if(first > last) return;
+    QVector<Range> &ranges = sections[section];
+    // ranges overlapping or touching [first,last] are merged into it
+    int i = firstRangeEndingFrom(ranges,first - 1);
+    int j = i;
+    while(j < ranges.size() && ranges.at(j).first <= last + 1){
+        first = qMin(first,ranges.at(j).first);
+        last = qMax(last,ranges.at(j).last);
+        j ++;
+    }
+    ranges.remove(i,j - i);
+    Range range = {first,last};
+    ranges.insert(i,range);
+}
+
+void WTableViewSelection::deselectRows(int section, int first, int last)
+{
+    if(first > last) return;
+    QMap<int,QVector<Range> >::iterator it = sections.find(section);
+    if(it == sections.end()) return;
+    QVector<Range> &ranges = it.value();
+    int i = firstRangeEndingFrom(ranges,first);
+    int j = i;
+    QVector<Range> kept;
+    while(j < ranges.size() && ranges.at(j).first <= last){
+        const Range &range = ranges.at(j);
+        if(range.first < first){
+            Range head = {range.first,first - 1};
+            kept.push_back(head);
+        }
+        if(range.last > last){
+            Range tail = {last + 1,range.last};
+            kept.push_back(tail);
+        }
+        j ++;
+    }
+    ranges.remove(i,j - i);
+    for(int k = 0; k < kept.size(); k ++){
+        ranges.insert(i + k,kept.at(k));
+    }
+    if(ranges.isEmpty()){
+        sections.erase(it);
+    }
+}
+
+void WTableViewSelection::invertRows(int section, int first, int last)
+{
+    if(first > last) return;
+    QVector<Range> &ranges = sections[section];
+    int i = firstRangeEndingFrom(ranges,first);
+    int j = i;
+    QVector<Range> inverted;
+    int next = first;// first row of [first,last] not handled yet
+    while(j < ranges.size() && ranges.at(j).first <= last){
+        const Range &range = ranges.at(j);
+        if(range.first < first){
+            Range head = {range.first,first - 1};
+            inverted.push_back(head);
+        }
+        if(range.first > next){
+            Range gap = {next,range.first - 1};
+            inverted.push_back(gap);
+        }
+        next = range.last + 1;
+        if(range.last > last){
+            Range tail = {last + 1,range.last};
+            inverted.push_back(tail);
+        }
+        j ++;
+    }
+    if(next <= last){
+        Range gap = {next,last};
+        inverted.push_back(gap);
+    }
+    ranges.remove(i,j - i);
+    for(int k = 0; k < inverted.size(); k ++){
+        ranges.insert(i + k,inverted.at(k));
+    }
+    if(ranges.isEmpty()){
+        sections.remove(section);
+    }
+}
+
+void WTableViewSelection::insertSection(int section)
+{
+    QMap<int,QVector<Range> > shifted;
+    for(QMap<int,QVector<Range> >::const_iterator it = sections.constBegin(); it != sections.constEnd(); ++it){
+        shifted.insert(it.key() >= section ? it.key() + 1 : it.key(),it.value());
+    }
+    sections = shifted;
+}
+
+void WTableViewSelection::removeSection(int section)
+{
+    QMap<int,QVector<Range> > shifted;
+    for(QMap<int,QVector<Range> >::const_iterator it = sections.constBegin(); it != sections.constEnd(); ++it){
+        if(it.key() == section) continue;
+        shifted.insert(it.key() > section ? it.key() - 1 : it.key(),it.value());
+    }
+    sections = shifted;
+}
+
+void WTableViewSelection::insertRows(int section, int row, int count)
+{
+    QMap<int,QVector<Range> >::iterator it = sections.find(section);
+    if(it == sections.end() || count <= 0) return;
+    QVector<Range> &ranges = it.value();
+    int i = firstRangeEndingFrom(ranges,row);
+    if(i < ranges.size() && ranges.at(i).first < row){
+        // the inserted rows split the range, they are not selected
+        Range tail = {row,ranges.at(i).last};
+        ranges[i].last = row - 1;
+        i ++;
+        ranges.insert(i,tail);
+    }
+    for(; i < ranges.size(); i ++){
+        ranges[i].first += count;
+        ranges[i].last += count;
+    }
+}
+
+void WTableViewSelection::removeRows(int section, int row, int count)
+{
+    if(count <= 0) return;
+    deselectRows(section,row,row + count - 1);
+    QMap<int,QVector<Range> >::iterator it = sections.find(section);
+    if(it == sections.end()) return;
+    QVector<Range> &ranges = it.value();
+    int i = firstRangeEndingFrom(ranges,row);
+    for(int j = i; j < ranges.size(); j ++){
+        ranges[j].first -= count;
+        ranges[j].last -= count;
+    }
+    // the ranges around the removed rows may touch now
+    if(i > 0 && i < ranges.size() && ranges.at(i - 1).last + 1 == ranges.at(i).first){
+        ranges[i - 1].last = ranges.at(i).last;
+        ranges.remove(i);
+    }
+}
+
+// the selected ranges of the block are taken out relative to its first row and selected again at the destination
+void WTableViewSelection::moveRows(const WIndexPath &fromIndexPath, int count, const WIndexPath &toIndexPath)
+{
+    if(count <= 0) return;
+    QVector<Range> moved;
+    QMap<int,QVector<Range> >::const_iterator it = sections.constFind(fromIndexPath.section);
+    if(it != sections.constEnd()){
+        const QVector<Range> &ranges = it.value();
+        int last = fromIndexPath.row + count - 1;
+        for(int i = firstRangeEndingFrom(ranges,fromIndexPath.row); i < ranges.size() && ranges.at(i).first <= last; i ++){
+            Range range = {qMax(ranges.at(i).first,fromIndexPath.row) - fromIndexPath.row,qMin(ranges.at(i).last,last) - fromIndexPath.row};
+            moved.push_back(range);
+        }
+    }
+    removeRows(fromIndexPath.section,fromIndexPath.row,count);
+    insertRows(toIndexPath.section,toIndexPath.row,count);
+    for(const Range &range:moved){
+        selectRows(toIndexPath.section,toIndexPath.row + range.first,toIndexPath.row + range.last);
+    }
+}
+
+// index of the first range whose last row is >= row, ranges.size() if there is none
+int WTableViewSelection::firstRangeEndingFrom(const QVector<Range> &ranges, int row)
+{
+    int lo = 0;
+    int hi = ranges.size();
+    while(lo < hi){
+        int mid = (lo + hi) / 2;
+        if(ranges.at(mid).last < row){
+            lo = mid + 1;
+        }else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
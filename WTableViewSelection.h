@@ -0,0 +1,44 @@
+//  Created by wangwei
+//  Copyright © 2017-03-25 ExecuteSystem. All rights reserved.
+#ifndef WTABLEVIEWSELECTION_H
+#define WTABLEVIEWSELECTION_H
+
+#include <QMap>
+#include <QVector>
+#include "WTableView.h"
+
+// Multiple selection of a WTableView.
+// Every section keeps its selected rows as sorted, disjoint and non adjacent ranges, so a
+// membership test is a binary search over the ranges of the section and selecting a whole
+// table costs one range per section. Row and section inserts and deletes shift the ranges.
+class WTableViewSelection
+{
+public:
+    WTableViewSelection();
+
+    bool contains(const WIndexPath &indexPath) const;
+    bool isEmpty() const;
+    qint64 count() const;
+    QVector<WIndexPath> indexPaths() const;// every selected row in order, mind the size of a large selection
+    void clear();
+    void selectRows(int section,int first,int last);
+    void deselectRows(int section,int first,int last);
+    void invertRows(int section,int first,int last);
+
+    void insertSection(int section);
+    void removeSection(int section);
+    void insertRows(int section,int row,int count);
+    void removeRows(int section,int row,int count);
+    void moveRows(const WIndexPath &fromIndexPath,int count,const WIndexPath &toIndexPath);// toIndexPath is counted without the moved rows
+
+private:
+    struct Range{
+        int first;
+        int last;
+    };
+    QMap<int,QVector<Range> > sections;
+
+    static int firstRangeEndingFrom(const QVector<Range> &ranges,int row);
+};
+
+#endif // WTABLEVIEWSELECTION_H
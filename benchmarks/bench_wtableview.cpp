@@ -0,0 +1,302 @@
+//  Created by wangwei
+//  Copyright © 2017-03-25 ExecuteSystem. All rights reserved.
+#include <QtTest>
+#include <random>
+#include "WTableView.h"
+#include "WTableViewDelegate.h"
+
+// Synthetic delegate of rows rows.
+// Uniform rows share one height, variable rows are estimated and get a height of their own once
+// they come near the viewport, sectioned rows are split in sections of SectionRows rows with a
+// uniform height per section.
+class BenchDelegate : public WTableViewDelegate
+{
+public:
+    enum Heights{
+        Uniform,
+        Variable,
+        Sectioned
+    };
+    static const int SectionRows = 1000;
+
+    BenchDelegate(Heights heights,int rows) : heights(heights)
+    {
+        if(heights == Sectioned){
+            sectionRows.fill(SectionRows,rows / SectionRows);
+            if(rows % SectionRows){
+                sectionRows.push_back(rows % SectionRows);
+            }
+        }else {
+            sectionRows.push_back(rows);
+        }
+    }
+
+    void insertRow(const WIndexPath &indexPath){sectionRows[indexPath.section] ++;}
+    void deleteRow(const WIndexPath &indexPath){sectionRows[indexPath.section] --;}
+
+    int numberOfSectionsInTableView(WTableView *) Q_DECL_OVERRIDE {return sectionRows.size();}
+    int tableViewNumberOfRowsInSection(WTableView *,int section) Q_DECL_OVERRIDE {return sectionRows.at(section);}
+    WTableViewCell *tableViewCellForRowAtIndex(WTableView *tableView,const WIndexPath &) Q_DECL_OVERRIDE
+    {
+        WTableViewCell *cell = tableView->dequeueReusableCellByIdentifier("row");
+        if(cell == nullptr){
+            cell = new WTableViewCell(tableView,"row");
+        }
+        return cell;
+    }
+    int tableViewHeightForRowAtIndexPath(WTableView *,const WIndexPath &indexPath) Q_DECL_OVERRIDE
+    {
+        quint32 hash = quint32(indexPath.section) * 2654435761u ^ quint32(indexPath.row) * 40503u;
+        return 24 + int(hash % 6) * 12;
+    }
+    int tableViewUniformRowHeightForSection(WTableView *,int section) Q_DECL_OVERRIDE
+    {
+        if(heights == Uniform) return 44;
+        if(heights == Sectioned) return 32 + section % 4 * 8;
+        return 0;
+    }
+    int tableViewEstimatedHeightForRowAtIndexPath(WTableView *,const WIndexPath &) Q_DECL_OVERRIDE {return heights == Variable ? 44 : 0;}
+    bool tableViewRowHeightsDependOnWidth(WTableView *) Q_DECL_OVERRIDE {return heights == Variable;}
+    int tableViewHeightForHeaderInSection(int) Q_DECL_OVERRIDE {return heights == Sectioned ? 28 : 0;}
+
+private:
+    Heights heights;
+    QVector<int> sectionRows;
+};
+
+// One benchmark per scenario, each run for every height mode at 10k, 1M and 10M rows.
+// A measured iteration ends with the queued flush and a paint, as a frame of the event loop would.
+// Run with QT_QPA_PLATFORM=offscreen, -o results.csv,csv or -o results.xml,xml give machine-readable results.
+class BenchWTableView : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void reloadData_data();
+    void reloadData();
+    void scrollStep_data();
+    void scrollStep();
+    void jumpToOffset_data();
+    void jumpToOffset();
+    void insertDeleteRow_data();
+    void insertDeleteRow();
+    void reloadRow_data();
+    void reloadRow();
+    void resize_data();
+    void resize();
+    void reusePoolChurn_data();
+    void reusePoolChurn();
+
+private:
+    void addRows();
+    void flush(WTableView &view);
+    void show(WTableView &view,BenchDelegate &delegate);
+    WIndexPath middleVisibleRow(WTableView &view);
+};
+
+void BenchWTableView::addRows()
+{
+    QTest::addColumn<int>("heights");
+    QTest::addColumn<int>("rows");
+    const char *heights[] = {"uniform","variable","sectioned"};
+    const int rows[] = {10000,1000000,10000000};
+    const char *rowNames[] = {"10k","1M","10M"};
+    for(int h = 0; h < 3; h ++){
+        for(int r = 0; r < 3; r ++){
+            QTest::newRow(QByteArray(heights[h]).append('/').append(rowNames[r]).constData()) << h << rows[r];
+        }
+    }
+}
+
+void BenchWTableView::flush(WTableView &view)
+{
+    QCoreApplication::sendPostedEvents();
+    view.repaint();
+}
+
+void BenchWTableView::show(WTableView &view, BenchDelegate &delegate)
+{
+    view.resize(480,800);
+    view.setDelegate(&delegate);
+    view.reloadData();
+    view.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&view));
+    flush(view);
+}
+
+WIndexPath BenchWTableView::middleVisibleRow(WTableView &view)
+{
+    QVector<WIndexPath> rows = view.indexPathsForVisibleRows();
+    return rows.isEmpty() ? WIndexPath(-1,-1) : rows.at(rows.size() / 2);
+}
+
+void BenchWTableView::reloadData_data()
+{
+    addRows();
+}
+
+// the layout index is rebuilt from the delegate and the first screen is rendered
+void BenchWTableView::reloadData()
+{
+    QFETCH(int,heights);
+    QFETCH(int,rows);
+    BenchDelegate delegate(BenchDelegate::Heights(heights),rows);
+    WTableView view;
+    show(view,delegate);
+    QBENCHMARK{
+        view.reloadData();
+        flush(view);
+    }
+}
+
+void BenchWTableView::scrollStep_data()
+{
+    addRows();
+}
+
+// a wheel step of 40 pixels from the middle of the content
+void BenchWTableView::scrollStep()
+{
+    QFETCH(int,heights);
+    QFETCH(int,rows);
+    BenchDelegate delegate(BenchDelegate::Heights(heights),rows);
+    WTableView view;
+    show(view,delegate);
+    qint64 maximum = view.getContentHeight() - view.height();
+    qint64 offset = maximum / 2;
+    view.setContentOffset(offset);
+    flush(view);
+    QBENCHMARK{
+        offset += 40;
+        if(offset > maximum){
+            offset = 0;
+        }
+        view.setContentOffset(offset);
+        flush(view);
+    }
+}
+
+void BenchWTableView::jumpToOffset_data()
+{
+    addRows();
+}
+
+// every frame lands on a random offset, no visible cell is kept
+void BenchWTableView::jumpToOffset()
+{
+    QFETCH(int,heights);
+    QFETCH(int,rows);
+    BenchDelegate delegate(BenchDelegate::Heights(heights),rows);
+    WTableView view;
+    show(view,delegate);
+    std::mt19937_64 random(1);
+    std::uniform_int_distribution<qint64> offsets(0,view.getContentHeight() - view.height());
+    QBENCHMARK{
+        view.setContentOffset(offsets(random));
+        flush(view);
+    }
+}
+
+void BenchWTableView::insertDeleteRow_data()
+{
+    addRows();
+}
+
+// a row is inserted in the middle of the viewport and deleted again, two frames per iteration
+void BenchWTableView::insertDeleteRow()
+{
+    QFETCH(int,heights);
+    QFETCH(int,rows);
+    BenchDelegate delegate(BenchDelegate::Heights(heights),rows);
+    WTableView view;
+    show(view,delegate);
+    view.setContentOffset(view.getContentHeight() / 2);
+    flush(view);
+    WIndexPath indexPath = middleVisibleRow(view);
+    QVERIFY(indexPath.isValid());
+    QBENCHMARK{
+        delegate.insertRow(indexPath);
+        view.insertRowAtIndexPath(indexPath);
+        flush(view);
+        delegate.deleteRow(indexPath);
+        view.deleteRowAtIndexPath(indexPath);
+        flush(view);
+    }
+}
+
+void BenchWTableView::reloadRow_data()
+{
+    addRows();
+}
+
+// a visible row is measured and configured again
+void BenchWTableView::reloadRow()
+{
+    QFETCH(int,heights);
+    QFETCH(int,rows);
+    BenchDelegate delegate(BenchDelegate::Heights(heights),rows);
+    WTableView view;
+    show(view,delegate);
+    view.setContentOffset(view.getContentHeight() / 2);
+    flush(view);
+    WIndexPath indexPath = middleVisibleRow(view);
+    QVERIFY(indexPath.isValid());
+    QBENCHMARK{
+        view.reloadRowAtIndexPath(indexPath);
+        flush(view);
+    }
+}
+
+void BenchWTableView::resize_data()
+{
+    addRows();
+}
+
+// the width goes back and forth, variable rows depend on the width and are measured again
+void BenchWTableView::resize()
+{
+    QFETCH(int,heights);
+    QFETCH(int,rows);
+    BenchDelegate delegate(BenchDelegate::Heights(heights),rows);
+    WTableView view;
+    show(view,delegate);
+    view.setContentOffset(view.getContentHeight() / 2);
+    flush(view);
+    int width = view.width();
+    QBENCHMARK{
+        width = width == 480 ? 520 : 480;
+        view.resize(width,view.height());
+        flush(view);
+    }
+}
+
+void BenchWTableView::reusePoolChurn_data()
+{
+    addRows();
+}
+
+// every frame replaces all the visible cells through the reuse pool, the pool must not grow
+void BenchWTableView::reusePoolChurn()
+{
+    QFETCH(int,heights);
+    QFETCH(int,rows);
+    BenchDelegate delegate(BenchDelegate::Heights(heights),rows);
+    WTableView view;
+    show(view,delegate);
+    qint64 offsets[] = {0,view.getContentHeight() - view.height()};
+    for(qint64 offset:offsets){
+        view.setContentOffset(offset);
+        flush(view);
+    }
+    int poolSize = view.reusePoolSize();
+    int frame = 0;
+    QBENCHMARK{
+        view.setContentOffset(offsets[frame ++ % 2]);
+        flush(view);
+    }
+    QCOMPARE(view.reusePoolSize(),poolSize);
+}
+
+QTEST_MAIN(BenchWTableView)
+
+#include "bench_wtableview.moc"
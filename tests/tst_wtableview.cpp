@@ -0,0 +1,305 @@
+//  Created by wangwei
+//  Copyright © 2017-03-25 ExecuteSystem. All rights reserved.
+#include <QtTest>
+#include "WTableView.h"
+#include "WTableViewDelegate.h"
+#include "WTableViewRingBuffer.h"
+
+static const int RowHeight = 20;
+static const int VisibleRows = 10;
+
+// A cell keeps the value of the row it was configured for.
+class TestCell : public WTableViewCell
+{
+public:
+    explicit TestCell(QWidget *parent) : WTableViewCell(parent,"row"),value(-1) {}
+    int value;
+};
+
+// One section of RowHeight rows holding int values, taken from a ring buffer when one is set. The
+// requests of the table view are counted.
+class TestDelegate : public WTableViewDelegate
+{
+public:
+    TestDelegate() : buffer(nullptr),cellRequests(0),loadMoreRequests(0) {}
+
+    QVector<int> rows;
+    WTableViewRingBuffer<int> *buffer;
+    int cellRequests;
+    int loadMoreRequests;
+    QVector<int> painted;// values of the rows painted in painted mode
+    QHash<int,quint64> versions;// content versions by value, so they follow their rows
+
+    int valueAt(int row) const {return buffer ? buffer->at(row) : rows.at(row);}
+    void fill(int count)
+    {
+        rows.clear();
+        for(int i = 0; i < count; i ++){
+            rows.push_back(i);
+        }
+    }
+
+    int numberOfSectionsInTableView(WTableView *) Q_DECL_OVERRIDE {return 1;}
+    int tableViewNumberOfRowsInSection(WTableView *,int) Q_DECL_OVERRIDE {return buffer ? buffer->size() : rows.size();}
+    WTableViewCell *tableViewCellForRowAtIndex(WTableView *tableView,const WIndexPath &indexPath) Q_DECL_OVERRIDE
+    {
+        cellRequests ++;
+        TestCell *cell = static_cast<TestCell *>(tableView->dequeueReusableCellByIdentifier("row"));
+        if(cell == nullptr){
+            cell = new TestCell(tableView);
+        }
+        cell->value = valueAt(indexPath.row);
+        return cell;
+    }
+    int tableViewHeightForRowAtIndexPath(WTableView *,const WIndexPath &) Q_DECL_OVERRIDE {return RowHeight;}
+    void tableViewPaintRowAtIndexPath(WTableView *,QPainter *,const QRect &,const WIndexPath &indexPath,bool) Q_DECL_OVERRIDE
+    {
+        painted.push_back(valueAt(indexPath.row));
+    }
+    void tableViewLoadMoreRows(WTableView *) Q_DECL_OVERRIDE {loadMoreRequests ++;}
+    quint64 tableViewContentVersionForRowAtIndexPath(WTableView *,const WIndexPath &indexPath) Q_DECL_OVERRIDE
+    {
+        return versions.value(valueAt(indexPath.row));
+    }
+};
+
+// The table view is driven through its public API under the offscreen platform, the visible cells are
+// compared with the rows of the delegate. A flush runs the queued update and paints, as a frame of the
+// event loop would.
+class TestWTableView : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void batchCommitsOnce();
+    void deleteAndMoveRows();
+    void paintedRowCache();
+    void followTail();
+    void loadMore();
+
+private:
+    void show(WTableView &view,TestDelegate &delegate);
+    void flush(WTableView &view);
+    int cellValue(WTableView &view,const WIndexPath &indexPath);// -1 without a visible cell
+    void verifyVisibleCells(WTableView &view,TestDelegate &delegate);
+};
+
+void TestWTableView::show(WTableView &view, TestDelegate &delegate)
+{
+    view.resize(200,VisibleRows * RowHeight);
+    view.setDelegate(&delegate);
+    view.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&view));
+    flush(view);
+}
+
+void TestWTableView::flush(WTableView &view)
+{
+    QCoreApplication::sendPostedEvents();
+    view.repaint();
+}
+
+int TestWTableView::cellValue(WTableView &view, const WIndexPath &indexPath)
+{
+    TestCell *cell = static_cast<TestCell *>(view.cellForRowAtIndexPath(indexPath));
+    return cell ? cell->value : -1;
+}
+
+void TestWTableView::verifyVisibleCells(WTableView &view, TestDelegate &delegate)
+{
+    QVector<WIndexPath> rows = view.indexPathsForVisibleRows();
+    QCOMPARE(rows.size(),VisibleRows);
+    for(const WIndexPath &indexPath:rows){
+        QCOMPARE(cellValue(view,indexPath),delegate.valueAt(indexPath.row));
+    }
+}
+
+// the changes of a batch only touch the layout index, the visible cells follow their rows and
+// the outermost endUpdates renders once
+void TestWTableView::batchCommitsOnce()
+{
+    WTableView view;
+    TestDelegate delegate;
+    delegate.fill(100);
+    show(view,delegate);
+    QCOMPARE(delegate.cellRequests,VisibleRows);
+
+    delegate.cellRequests = 0;
+    view.beginUpdates();
+    for(int i = 0; i < 5; i ++){
+        delegate.rows.insert(0,1000 + i);
+        view.insertRowAtIndexPath(WIndexPath(0,0));
+    }
+    delegate.rows.remove(7);
+    view.deleteRowAtIndexPath(WIndexPath(0,7));
+    QCoreApplication::sendPostedEvents();
+    QCOMPARE(delegate.cellRequests,0);
+    QCOMPARE(cellValue(view,WIndexPath(0,5)),0);
+    QCOMPARE(cellValue(view,WIndexPath(0,7)),3);
+    view.endUpdates();
+    flush(view);
+
+    // only the five inserted rows need a cell, the rows pushed out of the viewport give theirs back
+    QCOMPARE(delegate.cellRequests,5);
+    verifyVisibleCells(view,delegate);
+}
+
+// deleted rows take their cells and their selection with them, moved rows keep theirs
+void TestWTableView::deleteAndMoveRows()
+{
+    WTableView view;
+    TestDelegate delegate;
+    delegate.fill(100);
+    view.setAllowMultipleSelection(true);
+    show(view,delegate);
+    view.selectedRowAtIndexPath(WIndexPath(0,2));
+    view.selectedRowAtIndexPath(WIndexPath(0,4));
+    view.selectedRowAtIndexPath(WIndexPath(0,6));
+    view.selectedRowAtIndexPath(WIndexPath(0,7));
+
+    // only the two rows scrolled into view need a cell
+    delegate.cellRequests = 0;
+    delegate.rows.remove(3,2);
+    view.deleteRowsAtIndexPath(WIndexPath(0,3),2);
+    flush(view);
+    QCOMPARE(delegate.cellRequests,2);
+    QCOMPARE(view.indexPathsForSelectedRows(),QVector<WIndexPath>() << WIndexPath(0,2) << WIndexPath(0,4) << WIndexPath(0,5));
+    verifyVisibleCells(view,delegate);
+    if(QTest::currentTestFailed()) return;
+    QVERIFY(view.cellForRowAtIndexPath(WIndexPath(0,4))->isSelected());
+
+    // a block moved within the viewport keeps its cells
+    delegate.cellRequests = 0;
+    QVector<int> block = delegate.rows.mid(4,2);
+    delegate.rows.remove(4,2);
+    for(int i = 0; i < block.size(); i ++){
+        delegate.rows.insert(i,block.at(i));
+    }
+    view.moveRowsAtIndexPath(WIndexPath(0,4),2,WIndexPath(0,0));
+    flush(view);
+    QCOMPARE(delegate.cellRequests,0);
+    QCOMPARE(view.indexPathsForSelectedRows(),QVector<WIndexPath>() << WIndexPath(0,0) << WIndexPath(0,1) << WIndexPath(0,4));
+    verifyVisibleCells(view,delegate);
+    if(QTest::currentTestFailed()) return;
+
+    // a row moved below the viewport gives its cell back to the row scrolled into view
+    delegate.cellRequests = 0;
+    delegate.rows.insert(50,delegate.rows.takeAt(0));
+    view.moveRowAtIndexPath(WIndexPath(0,0),WIndexPath(0,50));
+    flush(view);
+    QCOMPARE(delegate.cellRequests,1);
+    QCOMPARE(view.indexPathsForSelectedRows(),QVector<WIndexPath>() << WIndexPath(0,0) << WIndexPath(0,3) << WIndexPath(0,50));
+    verifyVisibleCells(view,delegate);
+}
+
+// painted rows are kept until their row is reloaded or their content version changes, and follow
+// their rows when rows are deleted
+void TestWTableView::paintedRowCache()
+{
+    WTableView view;
+    TestDelegate delegate;
+    delegate.fill(100);
+    view.setRenderMode(WTableView::WTableViewRenderModePainted);
+    view.setRowCacheBudget(16 << 20);
+    show(view,delegate);
+    QCOMPARE(delegate.painted.size(),VisibleRows);
+
+    delegate.painted.clear();
+    view.repaint();
+    QVERIFY(delegate.painted.isEmpty());
+
+    delegate.rows[3] = 500;
+    view.reloadRowAtIndexPath(WIndexPath(0,3));
+    delegate.versions.insert(5,1);
+    flush(view);
+    std::sort(delegate.painted.begin(),delegate.painted.end());
+    QCOMPARE(delegate.painted,QVector<int>() << 5 << 500);
+
+    // only the row scrolled into view is painted
+    delegate.painted.clear();
+    delegate.rows.remove(0);
+    view.deleteRowAtIndexPath(WIndexPath(0,0));
+    flush(view);
+    QCOMPARE(delegate.painted,QVector<int>() << 10);
+}
+
+// rows appended to a full ring buffer push the oldest ones out, a view at the bottom stays there
+// and a view above it keeps its rows on screen
+void TestWTableView::followTail()
+{
+    WTableView view;
+    TestDelegate delegate;
+    WTableViewRingBuffer<int> buffer(50);
+    for(int i = 0; i < 50; i ++){
+        buffer.append(i);
+    }
+    delegate.buffer = &buffer;
+    show(view,delegate);
+    view.scrollToBottom();
+    flush(view);
+    QCOMPARE(view.contentOffset(),qint64(40 * RowHeight));
+
+    int dropped = 0;
+    for(int i = 50; i < 60; i ++){
+        dropped += buffer.append(i);
+    }
+    QCOMPARE(dropped,10);
+    view.appendRows(0,10,dropped);
+    flush(view);
+    QCOMPARE(view.getContentHeight(),qint64(50 * RowHeight));
+    QCOMPARE(view.contentOffset(),qint64(40 * RowHeight));
+    QCOMPARE(cellValue(view,WIndexPath(0,49)),59);
+    verifyVisibleCells(view,delegate);
+    if(QTest::currentTestFailed()) return;
+
+    view.setContentOffset(20 * RowHeight);
+    flush(view);
+    QCOMPARE(cellValue(view,WIndexPath(0,20)),30);
+    buffer.removeFirst(5);
+    view.removeRowsFromHead(0,5);
+    flush(view);
+    QCOMPARE(view.contentOffset(),qint64(15 * RowHeight));
+    QCOMPARE(cellValue(view,WIndexPath(0,15)),30);
+    verifyVisibleCells(view,delegate);
+}
+
+// the next page is requested once when the viewport nears the end, and again only after the
+// previous page was delivered
+void TestWTableView::loadMore()
+{
+    WTableView view;
+    TestDelegate delegate;
+    delegate.fill(30);
+    view.setLoadMoreThresholdRows(5);
+    show(view,delegate);
+    QCOMPARE(delegate.loadMoreRequests,0);
+
+    // three rows are left below the viewport
+    view.setContentOffset(17 * RowHeight);
+    flush(view);
+    QCOMPARE(delegate.loadMoreRequests,1);
+    QVERIFY(view.isLoadingMore());
+    view.setContentOffset(20 * RowHeight);
+    flush(view);
+    QCOMPARE(delegate.loadMoreRequests,1);
+
+    // the page does not move a table scrolled to the bottom
+    for(int i = 0; i < 20; i ++){
+        delegate.rows.push_back(30 + i);
+    }
+    view.finishLoadingMore(0,20);
+    flush(view);
+    QVERIFY(!view.isLoadingMore());
+    QCOMPARE(delegate.loadMoreRequests,1);
+    QCOMPARE(view.contentOffset(),qint64(20 * RowHeight));
+    verifyVisibleCells(view,delegate);
+    if(QTest::currentTestFailed()) return;
+
+    view.scrollToBottom();
+    flush(view);
+    QCOMPARE(delegate.loadMoreRequests,2);
+}
+
+QTEST_MAIN(TestWTableView)
+
+#include "tst_wtableview.moc"
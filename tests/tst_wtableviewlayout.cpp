@@ -0,0 +1,452 @@
+//  Created by wangwei
+//  Copyright © 2017-03-25 ExecuteSystem. All rights reserved.
+#include <QtTest>
+#include <random>
+#include <vector>
+#include "WTableViewLayout.h"
+
+// Random edits are applied to a WTableViewLayout and to a plain list of sections and rows,
+// every query of the layout is compared with the list after each edit.
+class TestWTableViewLayout : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void randomEdits_data();
+    void randomEdits();
+    void sectionIndex();
+    void grid();
+    void cachedRowHeights();
+    void tallContent();
+
+private:
+    struct Row{
+        int height;
+        bool estimated;
+        int cached;// height cached for version 1 and width 100, -1 if none
+    };
+    struct Section{
+        int header;
+        std::vector<Row> rows;
+    };
+    std::vector<Section> model;
+    std::mt19937 random;
+
+    int randomInt(int n);// [0,n)
+    void randomRows(std::vector<Row> &rows,QVector<int> &heights,QVector<bool> &estimated,int count);
+    void verify(const WTableViewLayout &layout);
+};
+
+int TestWTableViewLayout::randomInt(int n)
+{
+    return n <= 0 ? 0 : int(random() % quint32(n));
+}
+
+void TestWTableViewLayout::randomRows(std::vector<Row> &rows, QVector<int> &heights, QVector<bool> &estimated, int count)
+{
+    // runs of equal heights are likely so the layout merges and splits runs
+    int height = randomInt(8);
+    for(int i = 0; i < count; i ++){
+        if(randomInt(3) == 0){
+            height = randomInt(8);
+        }
+        Row row = {height,randomInt(2) == 0,-1};
+        rows.push_back(row);
+        heights.push_back(row.height);
+        estimated.push_back(row.estimated);
+    }
+}
+
+void TestWTableViewLayout::verify(const WTableViewLayout &layout)
+{
+    int sections = int(model.size());
+    QCOMPARE(layout.numberOfSections(),sections);
+    qint64 y = 0;
+    int estimatedRows = 0;
+    WIndexPath firstEstimated(-1,-1);
+    std::vector<WIndexPath> rowAtY;// row hit by every y of the content
+    std::vector<int> sectionAtY;
+    std::vector<WIndexPath> rows;
+    for(int s = 0; s < sections; s ++){
+        const Section &section = model.at(s);
+        QCOMPARE(layout.headerY(s),y);
+        QCOMPARE(layout.headerHeight(s),section.header);
+        QCOMPARE(layout.numberOfRowsInSection(s),int(section.rows.size()));
+        qint64 top = y;
+        for(int i = 0; i < section.header; i ++){
+            rowAtY.push_back(WIndexPath(-1,-1));
+            sectionAtY.push_back(s);
+        }
+        y += section.header;
+        for(int r = 0; r < int(section.rows.size()); r ++){
+            const Row &row = section.rows.at(r);
+            WIndexPath indexPath(s,r);
+            QCOMPARE(layout.rowY(indexPath),y);
+            QCOMPARE(layout.rowHeight(indexPath),row.height);
+            QCOMPARE(layout.isRowHeightEstimated(indexPath),row.estimated);
+            QCOMPARE(layout.cachedRowHeight(indexPath,1,100),row.cached);
+            if(row.estimated){
+                estimatedRows ++;
+                if(!firstEstimated.isValid()){
+                    firstEstimated = indexPath;
+                }
+            }
+            for(int i = 0; i < row.height; i ++){
+                rowAtY.push_back(indexPath);
+                sectionAtY.push_back(s);
+            }
+            rows.push_back(indexPath);
+            y += row.height;
+        }
+        QCOMPARE(layout.sectionHeight(s),y - top);
+    }
+    QCOMPARE(layout.contentHeight(),y);
+    QCOMPARE(layout.estimatedRowCount(),estimatedRows);
+    QVERIFY(layout.firstEstimatedRow() == firstEstimated);
+
+    // rows and sections in order with their bottoms, the first one ending below y is found by a sweep
+    std::vector<qint64> rowBottoms;
+    std::vector<qint64> sectionBottoms;
+    qint64 bottom = 0;
+    for(int s = 0; s < sections; s ++){
+        bottom += model.at(s).header;
+        for(const Row &row:model.at(s).rows){
+            bottom += row.height;
+            rowBottoms.push_back(bottom);
+        }
+        sectionBottoms.push_back(bottom);
+    }
+    int firstRow = 0;
+    int firstSection = 0;
+    for(qint64 at = -1; at <= y; at ++){
+        bool inside = at >= 0 && at < y;
+        WIndexPath expected = inside ? rowAtY.at(at) : WIndexPath(-1,-1);
+        QVERIFY(layout.indexPathForRowAtY(at) == expected);
+        QCOMPARE(layout.sectionAtY(at),inside ? sectionAtY.at(at) : -1);
+        while(firstRow < int(rows.size()) && rowBottoms.at(firstRow) <= at){
+            firstRow ++;
+        }
+        while(firstSection < sections && sectionBottoms.at(firstSection) <= at){
+            firstSection ++;
+        }
+        QVERIFY(layout.firstRowFromY(at) == (firstRow < int(rows.size()) ? rows.at(firstRow) : WIndexPath(-1,-1)));
+        QCOMPARE(layout.firstSectionFromY(at),firstSection);
+    }
+
+    for(int i = 0; i < int(rows.size()); i ++){
+        WIndexPath next = i + 1 < int(rows.size()) ? rows.at(i + 1) : WIndexPath(-1,-1);
+        QVERIFY(layout.nextIndexPath(rows.at(i)) == next);
+    }
+}
+
+void TestWTableViewLayout::randomEdits_data()
+{
+    QTest::addColumn<int>("seed");
+    for(int seed = 1; seed <= 8; seed ++){
+        QTest::newRow(QByteArray::number(seed).constData()) << seed;
+    }
+}
+
+void TestWTableViewLayout::randomEdits()
+{
+    QFETCH(int,seed);
+    random.seed(seed);
+    for(int round = 0; round < 20; round ++){
+        WTableViewLayout layout;
+        model.clear();
+        for(int edit = 0; edit < 150; edit ++){
+            int sections = int(model.size());
+            int s = randomInt(sections);
+            int rows = sections ? int(model.at(s).rows.size()) : 0;
+            switch(randomInt(13)){
+            case 0:{
+                // a section of rows of their own heights
+                Section section = {randomInt(6),std::vector<Row>()};
+                QVector<int> heights;
+                QVector<bool> estimated;
+                randomRows(section.rows,heights,estimated,randomInt(10));
+                int at = randomInt(sections + 1);
+                if(at == sections){
+                    layout.appendSection(section.header,heights,estimated);
+                }else {
+                    layout.insertSection(at,section.header,heights,estimated);
+                }
+                model.insert(model.begin() + at,section);
+                break;
+            }
+            case 1:{
+                // a section of uniform rows
+                Section section = {randomInt(6),std::vector<Row>()};
+                Row row = {randomInt(8),randomInt(2) == 0,-1};
+                int count = randomInt(10);
+                section.rows.assign(count,row);
+                int at = randomInt(sections + 1);
+                if(at == sections){
+                    layout.appendSection(section.header,count,row.height,row.estimated);
+                }else {
+                    layout.insertSection(at,section.header,count,row.height,row.estimated);
+                }
+                model.insert(model.begin() + at,section);
+                break;
+            }
+            case 2:
+                if(!sections) continue;
+                layout.removeSection(s);
+                model.erase(model.begin() + s);
+                break;
+            case 3:{
+                if(!sections) continue;
+                int at = randomInt(rows + 1);
+                std::vector<Row> inserted;
+                QVector<int> heights;
+                QVector<bool> estimated;
+                randomRows(inserted,heights,estimated,randomInt(5));
+                layout.insertRows(WIndexPath(s,at),heights,estimated);
+                model[s].rows.insert(model[s].rows.begin() + at,inserted.begin(),inserted.end());
+                break;
+            }
+            case 4:{
+                if(!sections) continue;
+                int at = randomInt(rows + 1);
+                Row row = {randomInt(8),randomInt(2) == 0,-1};
+                int count = randomInt(5);
+                layout.insertRows(WIndexPath(s,at),count,row.height,row.estimated);
+                model[s].rows.insert(model[s].rows.begin() + at,count,row);
+                break;
+            }
+            case 5:{
+                if(!rows) continue;
+                int at = randomInt(rows);
+                int count = randomInt(rows - at + 1);
+                layout.removeRows(WIndexPath(s,at),count);
+                model[s].rows.erase(model[s].rows.begin() + at,model[s].rows.begin() + at + count);
+                break;
+            }
+            case 6:
+            case 7:{
+                if(!rows) continue;
+                int at = randomInt(rows);
+                int height = randomInt(8);
+                layout.setRowHeight(WIndexPath(s,at),height);
+                model[s].rows[at].height = height;
+                model[s].rows[at].estimated = false;
+                break;
+            }
+            case 8:{
+                if(!sections) continue;
+                int height = randomInt(6);
+                layout.setHeaderHeight(s,height);
+                model[s].header = height;
+                break;
+            }
+            case 9:{
+                if(!sections) continue;
+                int height = randomInt(8);
+                layout.setRowHeights(s,height);
+                for(Row &row:model[s].rows){
+                    row.height = height;
+                    row.estimated = false;
+                    row.cached = -1;
+                }
+                break;
+            }
+            case 10:
+                if(!sections) continue;
+                layout.invalidateRowHeights(s);
+                for(Row &row:model[s].rows){
+                    row.estimated = true;
+                }
+                break;
+            case 11:{
+                if(!rows) continue;
+                int at = randomInt(rows);
+                if(randomInt(3) == 0){
+                    layout.removeCachedRowHeight(WIndexPath(s,at));
+                    model[s].rows[at].cached = -1;
+                }else {
+                    int height = randomInt(8);
+                    layout.cacheRowHeight(WIndexPath(s,at),1,100,height);
+                    model[s].rows[at].cached = height;
+                }
+                break;
+            }
+            case 12:{
+                // the destination is a row of the table once the moved rows are taken out
+                if(!rows) continue;
+                int at = randomInt(rows);
+                int count = randomInt(rows - at + 1);
+                int to = randomInt(sections);
+                std::vector<Row> moved(model[s].rows.begin() + at,model[s].rows.begin() + at + count);
+                model[s].rows.erase(model[s].rows.begin() + at,model[s].rows.begin() + at + count);
+                int toRow = randomInt(int(model[to].rows.size()) + 1);
+                layout.moveRows(WIndexPath(s,at),count,WIndexPath(to,toRow));
+                model[to].rows.insert(model[to].rows.begin() + toRow,moved.begin(),moved.end());
+                break;
+            }
+            }
+            verify(layout);
+            if(QTest::currentTestFailed()){
+                qWarning("round %d, edit %d",round,edit);
+                return;
+            }
+        }
+    }
+}
+
+// many small and empty sections, inserted and removed anywhere
+void TestWTableViewLayout::sectionIndex()
+{
+    random.seed(11);
+    WTableViewLayout layout;
+    model.clear();
+    for(int edit = 0; edit < 2000; edit ++){
+        int sections = int(model.size());
+        if(sections < 40 && randomInt(3) != 0){
+            Section section = {randomInt(3),std::vector<Row>()};
+            Row row = {1 + randomInt(3),false,-1};
+            int count = randomInt(3) == 0 ? 0 : randomInt(4);
+            section.rows.assign(count,row);
+            int at = randomInt(sections + 1);
+            layout.insertSection(at,section.header,count,row.height);
+            model.insert(model.begin() + at,section);
+        }else if(sections){
+            int s = randomInt(sections);
+            layout.removeSection(s);
+            model.erase(model.begin() + s);
+        }
+        if(edit % 20 == 0){
+            verify(layout);
+            if(QTest::currentTestFailed()){
+                qWarning("edit %d",edit);
+                return;
+            }
+        }
+    }
+}
+
+// rows flow into lines of columns rows, a row has the position and the height of its line
+void TestWTableViewLayout::grid()
+{
+    random.seed(5);
+    const int height = 7;
+    for(int columns = 1; columns <= 4; columns ++){
+        WTableViewLayout layout;
+        layout.setColumns(columns);
+        QCOMPARE(layout.getColumns(),columns);
+        std::vector<int> rows;
+        for(int s = 0; s < 3; s ++){
+            int count = randomInt(10);
+            layout.appendSection(2,count,height);
+            rows.push_back(count);
+        }
+        for(int edit = 0; edit < 200; edit ++){
+            int s = randomInt(3);
+            int kind = randomInt(3);
+            if(kind == 0){
+                int count = randomInt(7);
+                layout.insertRows(WIndexPath(s,randomInt(rows[s] + 1)),count,height);
+                rows[s] += count;
+            }else if(kind == 1 && rows[s]){
+                int at = randomInt(rows[s]);
+                int count = randomInt(rows[s] - at + 1);
+                int to = randomInt(3);
+                rows[s] -= count;
+                layout.moveRows(WIndexPath(s,at),count,WIndexPath(to,randomInt(rows[to] + 1)));
+                rows[to] += count;
+            }else if(rows[s]){
+                int at = randomInt(rows[s]);
+                int count = randomInt(rows[s] - at + 1);
+                layout.removeRows(WIndexPath(s,at),count);
+                rows[s] -= count;
+            }
+            qint64 y = 0;
+            for(int section = 0; section < 3; section ++){
+                QCOMPARE(layout.headerY(section),y);
+                QCOMPARE(layout.numberOfRowsInSection(section),rows[section]);
+                y += 2;
+                for(int r = 0; r < rows[section]; r ++){
+                    WIndexPath indexPath(section,r);
+                    qint64 lineY = y + qint64(r / columns) * height;
+                    QCOMPARE(layout.rowY(indexPath),lineY);
+                    QCOMPARE(layout.rowHeight(indexPath),height);
+                    QVERIFY(layout.indexPathForRowAtY(lineY + 3) == WIndexPath(section,r / columns * columns));
+                }
+                y += qint64((rows[section] + columns - 1) / columns) * height;
+            }
+            QCOMPARE(layout.contentHeight(),y);
+        }
+    }
+}
+
+// the cache follows its row through inserts and removals, and keeps the two most recent widths
+void TestWTableViewLayout::cachedRowHeights()
+{
+    WTableViewLayout layout;
+    layout.appendSection(0,10,5,true);
+    layout.cacheRowHeight(WIndexPath(0,4),1,100,30);
+    layout.cacheRowHeight(WIndexPath(0,4),1,200,20);
+    QCOMPARE(layout.cachedRowHeight(WIndexPath(0,4),1,100),30);
+    QCOMPARE(layout.cachedRowHeight(WIndexPath(0,4),1,200),20);
+    QCOMPARE(layout.cachedRowHeight(WIndexPath(0,4),2,200),-1);
+    QCOMPARE(layout.cachedRowHeight(WIndexPath(0,3),1,200),-1);
+    // caching a row isolates it in its own run, the rows around it are untouched
+    QCOMPARE(layout.estimatedRowCount(),10);
+    QCOMPARE(layout.contentHeight(),qint64(50));
+
+    layout.insertRows(WIndexPath(0,0),3,5);
+    QCOMPARE(layout.cachedRowHeight(WIndexPath(0,7),1,200),20);
+    layout.removeRows(WIndexPath(0,0),2);
+    QCOMPARE(layout.cachedRowHeight(WIndexPath(0,5),1,100),30);
+    layout.invalidateRowHeights(0);
+    QCOMPARE(layout.cachedRowHeight(WIndexPath(0,5),1,100),30);
+
+    layout.cacheRowHeight(WIndexPath(0,5),1,300,10);
+    QCOMPARE(layout.cachedRowHeight(WIndexPath(0,5),1,300),10);
+    QCOMPARE(layout.cachedRowHeight(WIndexPath(0,5),1,100),-1);
+    QCOMPARE(layout.cachedRowHeight(WIndexPath(0,5),1,200),20);
+    layout.cacheRowHeight(WIndexPath(0,5),2,300,15);
+    QCOMPARE(layout.cachedRowHeight(WIndexPath(0,5),2,300),15);
+    QCOMPARE(layout.cachedRowHeight(WIndexPath(0,5),1,200),-1);
+
+    layout.removeRows(WIndexPath(0,5),1);
+    for(int r = 0; r < layout.numberOfRowsInSection(0); r ++){
+        QCOMPARE(layout.cachedRowHeight(WIndexPath(0,r),2,300),-1);
+    }
+
+    // a grid line is no row of its own
+    WTableViewLayout grid;
+    grid.setColumns(3);
+    grid.appendSection(0,9,5);
+    grid.cacheRowHeight(WIndexPath(0,4),1,100,30);
+    QCOMPARE(grid.cachedRowHeight(WIndexPath(0,4),1,100),-1);
+}
+
+// positions past 2^31 pixels and a section invalidated in O(log N)
+void TestWTableViewLayout::tallContent()
+{
+    const int rows = 10000000;
+    WTableViewLayout layout;
+    layout.appendSection(30,rows,300);
+    layout.appendSection(30,1,44);
+    qint64 height = 30 + qint64(rows) * 300 + 30 + 44;
+    QCOMPARE(layout.contentHeight(),height);
+    QVERIFY(layout.contentHeight() > INT_MAX);
+    QCOMPARE(layout.rowY(WIndexPath(0,rows - 1)),30 + qint64(rows - 1) * 300);
+    QVERIFY(layout.indexPathForRowAtY(height - 1) == WIndexPath(1,0));
+    QVERIFY(layout.indexPathForRowAtY(30 + qint64(rows / 2) * 300 + 1) == WIndexPath(0,rows / 2));
+
+    layout.invalidateRowHeights(0);
+    QCOMPARE(layout.estimatedRowCount(),rows);
+    QVERIFY(layout.firstEstimatedRow() == WIndexPath(0,0));
+    layout.setRowHeight(WIndexPath(0,0),100);
+    layout.setRowHeight(WIndexPath(0,rows / 2),100);
+    QCOMPARE(layout.estimatedRowCount(),rows - 2);
+    QVERIFY(layout.firstEstimatedRow() == WIndexPath(0,1));
+    QVERIFY(!layout.isRowHeightEstimated(WIndexPath(0,rows / 2)));
+    QVERIFY(layout.isRowHeightEstimated(WIndexPath(0,rows / 2 + 1)));
+    QCOMPARE(layout.contentHeight(),height - 400);
+}
+
+QTEST_APPLESS_MAIN(TestWTableViewLayout)
+
+#include "tst_wtableviewlayout.moc"
@@ -0,0 +1,187 @@
+//  Created by wangwei
+//  Copyright © 2017-03-25 ExecuteSystem. All rights reserved.
+#include <QtTest>
+#include <QStandardItemModel>
+#include "WTableView.h"
+#include "WTableViewModelAdapter.h"
+
+static const int RowHeight = 20;
+static const int VisibleRows = 10;
+
+// A cell keeps the text of the row it was configured for.
+class TextCell : public WTableViewCell
+{
+public:
+    explicit TextCell(QWidget *parent) : WTableViewCell(parent,"text") {}
+    QString text;
+};
+
+class TestAdapter : public WTableViewModelAdapter
+{
+public:
+    explicit TestAdapter(WTableView *tableView) : WTableViewModelAdapter(tableView),cellRequests(0) {}
+
+    int cellRequests;
+
+    WTableViewCell *tableViewCellForRowAtIndex(WTableView *tableView,const WIndexPath &indexPath) Q_DECL_OVERRIDE
+    {
+        cellRequests ++;
+        TextCell *cell = static_cast<TextCell *>(tableView->dequeueReusableCellByIdentifier("text"));
+        if(cell == nullptr){
+            cell = new TextCell(tableView);
+        }
+        cell->text = modelIndexForIndexPath(indexPath).data().toString();
+        return cell;
+    }
+};
+
+// A list of strings whose rows move with beginMoveRows, QStandardItemModel has no moveRows.
+class MoveModel : public QAbstractListModel
+{
+public:
+    QStringList rows;
+
+    int rowCount(const QModelIndex &parent) const Q_DECL_OVERRIDE {return parent.isValid() ? 0 : rows.size();}
+    QVariant data(const QModelIndex &index,int role) const Q_DECL_OVERRIDE
+    {
+        if(!index.isValid() || role != Qt::DisplayRole) return QVariant();
+        return rows.at(index.row());
+    }
+    // destination counts the rows before the block is taken out
+    void move(int first,int count,int destination)
+    {
+        QVERIFY(beginMoveRows(QModelIndex(),first,first + count - 1,QModelIndex(),destination));
+        QStringList block = rows.mid(first,count);
+        for(int i = 0; i < count; i ++){
+            rows.removeAt(first);
+        }
+        int to = destination > first ? destination - count : destination;
+        for(int i = 0; i < count; i ++){
+            rows.insert(to + i,block.at(i));
+        }
+        endMoveRows();
+    }
+};
+
+// The model signals of an event loop pass reach the table view as one batch, a flush lets the batch
+// finish and paints. The visible cells are compared with the model.
+class TestWTableViewModelAdapter : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void insertAndSortRows();
+    void moveRows();
+
+private:
+    void show(WTableView &view,TestAdapter &adapter,QAbstractItemModel *model);
+    void flush(WTableView &view);
+    void verifyVisibleCells(WTableView &view,TestAdapter &adapter);
+    QVector<WIndexPath> rowsWithText(QAbstractItemModel *model,const QStringList &texts);
+};
+
+void TestWTableViewModelAdapter::show(WTableView &view, TestAdapter &adapter, QAbstractItemModel *model)
+{
+    view.resize(200,VisibleRows * RowHeight);
+    view.setAllowMultipleSelection(true);
+    adapter.setDefaultRowHeight(RowHeight);
+    adapter.setModel(model);
+    view.show();
+    QVERIFY(QTest::qWaitForWindowExposed(&view));
+    flush(view);
+}
+
+void TestWTableViewModelAdapter::flush(WTableView &view)
+{
+    QTest::qWait(10);
+    QCoreApplication::sendPostedEvents();
+    view.repaint();
+}
+
+void TestWTableViewModelAdapter::verifyVisibleCells(WTableView &view, TestAdapter &adapter)
+{
+    QVector<WIndexPath> rows = view.indexPathsForVisibleRows();
+    QCOMPARE(rows.size(),VisibleRows);
+    for(const WIndexPath &indexPath:rows){
+        TextCell *cell = static_cast<TextCell *>(view.cellForRowAtIndexPath(indexPath));
+        QVERIFY(cell);
+        QCOMPARE(cell->text,adapter.modelIndexForIndexPath(indexPath).data().toString());
+    }
+}
+
+QVector<WIndexPath> TestWTableViewModelAdapter::rowsWithText(QAbstractItemModel *model, const QStringList &texts)
+{
+    QVector<WIndexPath> rows;
+    for(int row = 0; row < model->rowCount(); row ++){
+        if(texts.contains(model->index(row,0).data().toString())){
+            rows.push_back(WIndexPath(0,row));
+        }
+    }
+    return rows;
+}
+
+// inserted and appended rows show up in place, a sort refreshes the content and the selection
+// follows its rows
+void TestWTableViewModelAdapter::insertAndSortRows()
+{
+    QStandardItemModel model;
+    for(int i = 0; i < 100; i ++){
+        model.appendRow(new QStandardItem(QString("row %1").arg(99 - i,2,10,QChar('0'))));
+    }
+    WTableView view;
+    TestAdapter adapter(&view);
+    show(view,adapter,&model);
+    verifyVisibleCells(view,adapter);
+    if(QTest::currentTestFailed()) return;
+
+    model.insertRow(0,new QStandardItem("inserted 0"));
+    model.insertRow(3,new QStandardItem("inserted 3"));
+    model.appendRow(new QStandardItem("appended"));
+    flush(view);
+    QCOMPARE(view.getContentHeight(),qint64(103 * RowHeight));
+    verifyVisibleCells(view,adapter);
+    if(QTest::currentTestFailed()) return;
+
+    view.selectedRowAtIndexPath(WIndexPath(0,3));
+    view.selectedRowAtIndexPath(WIndexPath(0,5));
+    QStringList selected = QStringList() << "inserted 3" << model.index(5,0).data().toString();
+    model.sort(0);
+    flush(view);
+    QCOMPARE(view.indexPathsForSelectedRows(),rowsWithText(&model,selected));
+    verifyVisibleCells(view,adapter);
+}
+
+// a moved block keeps its cells and its selection
+void TestWTableViewModelAdapter::moveRows()
+{
+    MoveModel model;
+    for(int i = 0; i < 100; i ++){
+        model.rows.push_back(QString("row %1").arg(i));
+    }
+    WTableView view;
+    TestAdapter adapter(&view);
+    show(view,adapter,&model);
+    view.selectedRowAtIndexPath(WIndexPath(0,2));
+    view.selectedRowAtIndexPath(WIndexPath(0,8));
+    QStringList selected = QStringList() << "row 2" << "row 8";
+
+    adapter.cellRequests = 0;
+    model.move(6,3,0);
+    flush(view);
+    QCOMPARE(adapter.cellRequests,0);
+    QCOMPARE(view.indexPathsForSelectedRows(),QVector<WIndexPath>() << WIndexPath(0,2) << WIndexPath(0,5));
+    verifyVisibleCells(view,adapter);
+    if(QTest::currentTestFailed()) return;
+
+    // moved below the viewport, the row scrolled into view needs a cell
+    model.move(0,1,51);
+    flush(view);
+    QCOMPARE(adapter.cellRequests,1);
+    QCOMPARE(view.indexPathsForSelectedRows(),rowsWithText(&model,selected));
+    QCOMPARE(model.rows.at(50),QString("row 6"));
+    verifyVisibleCells(view,adapter);
+}
+
+QTEST_MAIN(TestWTableViewModelAdapter)
+
+#include "tst_wtableviewmodeladapter.moc"
@@ -0,0 +1,177 @@
+//  Created by wangwei
+//  Copyright © 2017-03-25 ExecuteSystem. All rights reserved.
+#include <QtTest>
+#include <random>
+#include <vector>
+#include "WTableViewSelection.h"
+
+// Random range operations and row and section edits are applied to a WTableViewSelection and to
+// one flag per row, the selection is compared with the flags after each operation.
+class TestWTableViewSelection : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void randomOperations_data();
+    void randomOperations();
+    void wholeTable();
+
+private:
+    std::vector<std::vector<bool> > model;// selected flag of every row, by section
+    std::mt19937 random;
+
+    int randomInt(int n);// [0,n)
+    void verify(const WTableViewSelection &selection);
+};
+
+int TestWTableViewSelection::randomInt(int n)
+{
+    return n <= 0 ? 0 : int(random() % quint32(n));
+}
+
+void TestWTableViewSelection::verify(const WTableViewSelection &selection)
+{
+    QVector<WIndexPath> expected;
+    for(int s = 0; s < int(model.size()); s ++){
+        for(int r = 0; r < int(model.at(s).size()); r ++){
+            QCOMPARE(selection.contains(WIndexPath(s,r)),bool(model.at(s).at(r)));
+            if(model.at(s).at(r)){
+                expected.push_back(WIndexPath(s,r));
+            }
+        }
+    }
+    QCOMPARE(selection.count(),qint64(expected.size()));
+    QCOMPARE(selection.isEmpty(),expected.isEmpty());
+    QVERIFY(selection.indexPaths() == expected);
+}
+
+void TestWTableViewSelection::randomOperations_data()
+{
+    QTest::addColumn<int>("seed");
+    for(int seed = 1; seed <= 8; seed ++){
+        QTest::newRow(QByteArray::number(seed).constData()) << seed;
+    }
+}
+
+void TestWTableViewSelection::randomOperations()
+{
+    QFETCH(int,seed);
+    random.seed(seed);
+    for(int round = 0; round < 20; round ++){
+        WTableViewSelection selection;
+        model.assign(1 + randomInt(4),std::vector<bool>());
+        for(std::vector<bool> &rows:model){
+            rows.assign(randomInt(30),false);
+        }
+        for(int operation = 0; operation < 300; operation ++){
+            int sections = int(model.size());
+            int s = randomInt(sections);
+            int rows = sections ? int(model.at(s).size()) : 0;
+            int first = randomInt(rows);
+            int last = first + randomInt(rows - first);
+            switch(randomInt(10)){
+            case 0:
+            case 1:
+                if(!rows) continue;
+                selection.selectRows(s,first,last);
+                for(int r = first; r <= last; r ++){
+                    model[s][r] = true;
+                }
+                break;
+            case 2:
+                if(!rows) continue;
+                selection.deselectRows(s,first,last);
+                for(int r = first; r <= last; r ++){
+                    model[s][r] = false;
+                }
+                break;
+            case 3:
+                if(!rows) continue;
+                selection.invertRows(s,first,last);
+                for(int r = first; r <= last; r ++){
+                    model[s][r] = !model[s][r];
+                }
+                break;
+            case 4:{
+                // inserted rows are not selected
+                if(!sections) continue;
+                int at = randomInt(rows + 1);
+                int count = randomInt(6);
+                selection.insertRows(s,at,count);
+                model[s].insert(model[s].begin() + at,count,false);
+                break;
+            }
+            case 5:{
+                if(!rows) continue;
+                int count = randomInt(rows - first + 1);
+                selection.removeRows(s,first,count);
+                model[s].erase(model[s].begin() + first,model[s].begin() + first + count);
+                break;
+            }
+            case 6:{
+                // the destination is a row of the table once the moved rows are taken out
+                if(!rows) continue;
+                int count = last - first + 1;
+                int to = randomInt(sections);
+                int toRows = int(model.at(to).size()) - (to == s ? count : 0);
+                int at = randomInt(toRows + 1);
+                std::vector<bool> moved(model[s].begin() + first,model[s].begin() + last + 1);
+                selection.moveRows(WIndexPath(s,first),count,WIndexPath(to,at));
+                model[s].erase(model[s].begin() + first,model[s].begin() + last + 1);
+                model[to].insert(model[to].begin() + at,moved.begin(),moved.end());
+                break;
+            }
+            case 7:{
+                int at = randomInt(sections + 1);
+                selection.insertSection(at);
+                model.insert(model.begin() + at,std::vector<bool>(randomInt(30),false));
+                break;
+            }
+            case 8:
+                if(sections <= 1) continue;
+                selection.removeSection(s);
+                model.erase(model.begin() + s);
+                break;
+            case 9:
+                if(randomInt(10) != 0) continue;
+                selection.clear();
+                for(std::vector<bool> &flags:model){
+                    flags.assign(flags.size(),false);
+                }
+                break;
+            }
+            verify(selection);
+            if(QTest::currentTestFailed()){
+                qWarning("round %d, operation %d",round,operation);
+                return;
+            }
+        }
+    }
+}
+
+// a table of ten million rows is one range, edits in the middle cost a few ranges
+void TestWTableViewSelection::wholeTable()
+{
+    const int rows = 10000000;
+    WTableViewSelection selection;
+    selection.selectRows(0,0,rows - 1);
+    selection.selectRows(1,0,rows - 1);
+    QCOMPARE(selection.count(),qint64(rows) * 2);
+    selection.deselectRows(0,100,199);
+    selection.insertRows(0,rows / 2,10);
+    selection.removeRows(1,0,rows / 2);
+    QCOMPARE(selection.count(),qint64(rows) * 2 - 100 - rows / 2);
+    QVERIFY(!selection.contains(WIndexPath(0,150)));
+    QVERIFY(!selection.contains(WIndexPath(0,rows / 2 + 5)));
+    QVERIFY(selection.contains(WIndexPath(0,rows / 2 + 10)));
+    QVERIFY(selection.contains(WIndexPath(0,rows + 9)));
+    QVERIFY(!selection.contains(WIndexPath(0,rows + 10)));
+    QVERIFY(selection.contains(WIndexPath(1,rows / 2 - 1)));
+    QVERIFY(!selection.contains(WIndexPath(1,rows / 2)));
+    selection.invertRows(0,0,rows + 9);
+    QCOMPARE(selection.count(),qint64(100 + 10 + rows / 2));
+}
+
+QTEST_APPLESS_MAIN(TestWTableViewSelection)
+
+#include "tst_wtableviewselection.moc"